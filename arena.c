@@ -0,0 +1,39 @@
+#include <stdint.h>
+#include <string.h>
+#include "game.h"
+#include "arena.h"
+
+void arena_init(Arena *arena, size_t size) {
+    size = ARENA_SIZE(size);
+    arena->block = game_alloc(size + ARENA_ALIGN);
+    uintptr_t base = ((uintptr_t)arena->block + ARENA_ALIGN - 1) & ~(uintptr_t)(ARENA_ALIGN - 1);
+    arena->base = (unsigned char *)base;
+    arena->size = size;
+    arena->used = 0;
+}
+
+void arena_free(Arena *arena) {
+    game_release(arena->block);
+    memset(arena, 0, sizeof(*arena));
+}
+
+void arena_init_sub(Arena *arena, Arena *parent, size_t size) {
+    size = ARENA_SIZE(size);
+    arena->block = NULL; // owned by the parent
+    arena->base = arena_alloc(parent, size);
+    arena->size = size;
+    arena->used = 0;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    size = ARENA_SIZE(size);
+    if (size > arena->size - arena->used) die("arena_alloc");
+    void *ptr = arena->base + arena->used;
+    arena->used += size;
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+void arena_reset(Arena *arena) {
+    arena->used = 0;
+}
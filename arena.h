@@ -0,0 +1,37 @@
+#ifndef SNAKE_ARENA_H
+#define SNAKE_ARENA_H
+
+/* Bump allocator over a single block reserved up front. Everything a game
+   needs is sized when it starts, carved out of its arena and released all at
+   once, so the system allocator is only involved at init and teardown. */
+
+#include <stddef.h>
+
+#define ARENA_ALIGN 64 // cache line, also keeps SIMD loads aligned
+
+// bytes an allocation of `size` takes in an arena, padding included
+#define ARENA_SIZE(size) (((size_t)(size) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+typedef struct {
+    void *block;                 // What game_alloc returned, for release
+    unsigned char *base;         // First aligned byte of the block
+    size_t size;                 // Usable bytes from base
+    size_t used;                 // Bytes handed out
+} Arena;
+
+void arena_init(Arena *arena, size_t size);
+void arena_free(Arena *arena);
+
+// zeroed, ARENA_ALIGN-aligned memory; running out of space is fatal (the size was wrong)
+void *arena_alloc(Arena *arena, size_t size);
+
+// zeroed array of `count` objects of `type`
+#define ARENA_NEW(arena, type, count) ((type *)arena_alloc((arena), sizeof(type) * (size_t)(count)))
+
+// carve `size` bytes out of `parent` as an arena of its own, released with the parent
+void arena_init_sub(Arena *arena, Arena *parent, size_t size);
+
+// forget every allocation, the block stays reserved
+void arena_reset(Arena *arena);
+
+#endif
@@ -0,0 +1,472 @@
+#include <stdlib.h>
+#include <string.h>
+#include "autopilot.h"
+
+// indexed by enum direction
+static const int step_dx[] = { 0, 0, -1, 1 };
+static const int step_dy[] = { -1, 1, 0, 0 };
+
+/* Setup */
+// one lap over an even number of lanes: out along lane 0 from position 1, back along lane 1
+// to position 1, ..., and home along position 0 of every lane
+static void cycle_step(int lane, int pos, int lanes, int length, int *next_lane, int *next_pos) {
+    *next_lane = lane;
+    *next_pos = pos;
+    if (pos == 0) {
+        if (lane > 0) *next_lane = lane - 1;
+        else *next_pos = 1;
+    } else if (lane % 2 == 0) {
+        if (pos < length - 1) *next_pos = pos + 1;
+        else *next_lane = lane + 1;
+    } else if (pos > 1) {
+        *next_pos = pos - 1;
+    } else if (lane < lanes - 1) {
+        *next_lane = lane + 1;
+    } else {
+        *next_pos = 0;
+    }
+}
+
+// lanes are rows when there is an even number of them, columns otherwise
+static void build_cycle(int *cycle, int width, int height) {
+    int by_rows = height % 2 == 0;
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            int lane, pos;
+            if (by_rows) {
+                cycle_step(row, col, height, width, &lane, &pos);
+                cycle[row * width + col] = lane * width + pos;
+            } else {
+                cycle_step(col, row, width, height, &lane, &pos);
+                cycle[row * width + col] = pos * width + lane;
+            }
+        }
+    }
+}
+
+void autopilot_init(Autopilot *autopilot, const GameState *state, int budget) {
+    memset(autopilot, 0, sizeof(*autopilot));
+    int width = state->cols - 2;
+    int height = state->rows - 2;
+    int size = width * height;
+    int has_cycle = width % 2 == 0 || height % 2 == 0;
+
+    size_t cells = ARENA_SIZE(size * sizeof(int));
+    size_t stamps = ARENA_SIZE(size * sizeof(uint32_t));
+    size_t ticks = ARENA_SIZE(size * sizeof(int16_t));
+    arena_init(&autopilot->arena, (has_cycle ? cells : 0) + 5 * cells + 4 * stamps + 2 * ticks +
+                                  ARENA_SIZE((4 * (size_t)size + 4) * sizeof(uint64_t)));
+    Arena *arena = &autopilot->arena;
+    if (has_cycle) {
+        autopilot->cycle = ARENA_NEW(arena, int, size);
+        build_cycle(autopilot->cycle, width, height);
+    }
+    autopilot->slot = ARENA_NEW(arena, int, size);
+    autopilot->seen = ARENA_NEW(arena, uint32_t, size);
+    autopilot->reached = ARENA_NEW(arena, uint32_t, size);
+    autopilot->on_path = ARENA_NEW(arena, uint32_t, size);
+    autopilot->danger = ARENA_NEW(arena, uint32_t, size);
+    autopilot->g = ARENA_NEW(arena, int32_t, size);
+    autopilot->parent = ARENA_NEW(arena, int, size);
+    // a cell is expanded at most once and pushes at most 4 neighbours
+    autopilot->heap = ARENA_NEW(arena, uint64_t, 4 * (size_t)size + 4);
+    autopilot->queue = ARENA_NEW(arena, int, size);
+    autopilot->danger_from = ARENA_NEW(arena, int16_t, size);
+    autopilot->danger_until = ARENA_NEW(arena, int16_t, size);
+    autopilot->path = ARENA_NEW(arena, int, size);
+
+    autopilot->width = width;
+    autopilot->height = height;
+    autopilot->budget = budget > 0 ? budget : AUTOPILOT_DEFAULT_BUDGET;
+    autopilot_reset(autopilot);
+}
+
+void autopilot_free(Autopilot *autopilot) {
+    arena_free(&autopilot->arena);
+    autopilot->cycle = NULL;
+}
+
+void autopilot_reset(Autopilot *autopilot) {
+    autopilot->last_head = -1;
+    autopilot->path_length = 0;
+    autopilot->path_food = -1;
+}
+
+// stamps tell this search's cells apart from older ones, so nothing is cleared between searches
+static void next_generation(Autopilot *autopilot) {
+    if (++autopilot->generation == 0) {
+        size_t bytes = (size_t)autopilot->width * autopilot->height * sizeof(uint32_t);
+        memset(autopilot->seen, 0, bytes);
+        memset(autopilot->reached, 0, bytes);
+        memset(autopilot->on_path, 0, bytes);
+        autopilot->generation = 1;
+    }
+}
+
+/* Cells */
+static inline int cell_of(const Autopilot *autopilot, int x, int y) {
+    return (y - 1) * autopilot->width + (x - 1);
+}
+
+// the cell next to (row, col) of the playable area, -1 past its edge when the snake can't wrap
+static inline int neighbour(const Autopilot *autopilot, int row, int col, int dir, int wrap, int *out_row, int *out_col) {
+    row += step_dy[dir];
+    col += step_dx[dir];
+    if (row < 0 || row >= autopilot->height || col < 0 || col >= autopilot->width) {
+        if (!wrap) return -1;
+        row = row < 0 ? autopilot->height - 1 : (row >= autopilot->height ? 0 : row);
+        col = col < 0 ? autopilot->width - 1 : (col >= autopilot->width ? 0 : col);
+    }
+    *out_row = row;
+    *out_col = col;
+    return row * autopilot->width + col;
+}
+
+static inline int in_danger(const Autopilot *autopilot, int cell, int t) {
+    return autopilot->danger[cell] == autopilot->danger_generation &&
+           t >= autopilot->danger_from[cell] && t <= autopilot->danger_until[cell];
+}
+
+static inline int is_body(const GameState *state, int row, int col) {
+    return board_test(&state->layers[LAYER_BODY], row + 1, col + 1) | board_test(&state->layers[LAYER_HEAD], row + 1, col + 1);
+}
+
+// whether the body is off the cell when the head moves onto it `t` ticks from now, with `length`
+// segments at that point. A cell the head entered at tick e (the segment `d` slots behind the head
+// entered at -d) is left when the tail moves on, and the tail only moves after the head's
+// collision check: the cell is clear from tick e + length + 1
+static inline int body_clear(const Autopilot *autopilot, const GameState *state, int cell, int row, int col, int t, int length) {
+    if (autopilot->on_path[cell] == autopilot->generation) return t > autopilot->g[cell] + length;
+    if (!is_body(state, row, col)) return 1;
+    int behind = autopilot->slot[cell] - state->snake.head;
+    if (behind < 0) behind += state->snake.capacity;
+    return t > length - behind;
+}
+
+static inline int can_enter(const Autopilot *autopilot, const GameState *state, int cell, int row, int col, int t, int length) {
+    return !in_danger(autopilot, cell, t) && body_clear(autopilot, state, cell, row, col, t, length);
+}
+
+static enum direction direction_to(const Autopilot *autopilot, int from, int to) {
+    int row, col;
+    for (int dir = UP; dir <= RIGHT; dir++) {
+        if (neighbour(autopilot, from / autopilot->width, from % autopilot->width, dir, 1, &row, &col) == to) {
+            return (enum direction)dir;
+        }
+    }
+    return NONE;
+}
+
+/* Tracking the game */
+// keep the ring slot of every body cell: one store per tick while the snake just moves on,
+// a walk over the body when the game jumped
+static void sync_body(Autopilot *autopilot, const GameState *state) {
+    const SnakeBody *body = &state->snake;
+    const SnakeSegment *head = &body->segments[body->head];
+    int cell = cell_of(autopilot, head->x, head->y);
+    int last = autopilot->last_head;
+    autopilot->last_head = cell;
+    if (last == cell && autopilot->slot[cell] == body->head) return;
+    if (last >= 0 && body->length > 1) {
+        int neck = body->head + 1 == body->capacity ? 0 : body->head + 1;
+        const SnakeSegment *segment = &body->segments[neck];
+        if (autopilot->slot[last] == neck && cell_of(autopilot, segment->x, segment->y) == last) {
+            autopilot->slot[cell] = body->head;
+            return;
+        }
+    }
+    int slot = body->head;
+    for (int i = 0; i < body->length; i++) {
+        const SnakeSegment *segment = &body->segments[slot];
+        autopilot->slot[cell_of(autopilot, segment->x, segment->y)] = slot;
+        slot = slot + 1 == body->capacity ? 0 : slot + 1;
+    }
+}
+
+static void mark_danger(Autopilot *autopilot, int cell, int from, int until) {
+    if (autopilot->danger[cell] != autopilot->danger_generation) {
+        autopilot->danger[cell] = autopilot->danger_generation;
+        autopilot->danger_from[cell] = (int16_t)from;
+        autopilot->danger_until[cell] = (int16_t)until;
+        return;
+    }
+    if (from < autopilot->danger_from[cell]) autopilot->danger_from[cell] = (int16_t)from;
+    if (until > autopilot->danger_until[cell]) autopilot->danger_until[cell] = (int16_t)until;
+}
+
+// follow every enemy's flow field steps the way compute_enemy_position will. The snake moves
+// first in a tick, so an enemy that moves at tick m is deadly on its old cell up to tick m and
+// on its new one from tick m, when it could step onto the head
+static void predict_enemies(Autopilot *autopilot, const GameState *state) {
+    if (++autopilot->danger_generation == 0) {
+        memset(autopilot->danger, 0, (size_t)autopilot->width * autopilot->height * sizeof(uint32_t));
+        autopilot->danger_generation = 1;
+    }
+    const EnemyPool *pool = &state->enemies;
+    const FlowField *flow = &state->flow;
+    int first = ENEMY_MOVE_INTERVAL - state->enemy_move_counter;
+    for (int i = 0; i < pool->count; i++) {
+        int row = pool->y[i] - 1;
+        int col = pool->x[i] - 1;
+        int cell = row * autopilot->width + col;
+        mark_danger(autopilot, cell, 1, first);
+        // the field is patched for the body's last moves only when the enemies move, so the
+        // very next step can go any way: all four neighbours are dangerous
+        for (int dir = UP; dir <= RIGHT; dir++) {
+            int next_row, next_col;
+            mark_danger(autopilot, neighbour(autopilot, row, col, dir, 1, &next_row, &next_col), first, first + ENEMY_MOVE_INTERVAL);
+        }
+        for (int move = 0; move < AUTOPILOT_ENEMY_MOVES; move++) {
+            // no field before the enemies' first move: predict they stay
+            int step = flow->target >= 0 ? flow->step[cell] : FLOW_STAY;
+            if (step != FLOW_STAY) cell = neighbour(autopilot, row, col, step, 1, &row, &col);
+            int from = first + move * ENEMY_MOVE_INTERVAL;
+            mark_danger(autopilot, cell, from, from + ENEMY_MOVE_INTERVAL);
+        }
+    }
+}
+
+/* Searches */
+static inline int axis_distance(int a, int b, int size, int wrap) {
+    int d = abs(a - b);
+    return wrap && size - d < d ? size - d : d;
+}
+
+static void heap_push(uint64_t *heap, int *count, uint64_t key) {
+    int i = (*count)++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (heap[parent] <= key) break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = key;
+}
+
+static uint64_t heap_pop(uint64_t *heap, int *count) {
+    uint64_t top = heap[0];
+    uint64_t last = heap[--*count];
+    int n = *count;
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= n) break;
+        if (child + 1 < n && heap[child + 1] < heap[child]) child++;
+        if (heap[child] >= last) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+// A* from start to goal over the cells the head can enter when it gets there. On success the
+// path holds start to goal, g of each of its cells is its index, and the result is its ticks
+static int find_path(Autopilot *autopilot, const GameState *state, int start, int goal, int budget) {
+    int width = autopilot->width;
+    int height = autopilot->height;
+    int wrap = state->score >= LEVEL_UPGRADE_SCORE;
+    int length = state->snake.length;
+    int goal_row = goal / width, goal_col = goal % width;
+    uint64_t *heap = autopilot->heap;
+    int count = 0;
+
+    next_generation(autopilot);
+    uint32_t generation = autopilot->generation;
+    autopilot->seen[start] = generation;
+    autopilot->g[start] = 0;
+    autopilot->parent[start] = -1;
+    int h = axis_distance(start / width, goal_row, height, wrap) + axis_distance(start % width, goal_col, width, wrap);
+    heap_push(heap, &count, (uint64_t)h << 32 | (uint32_t)start);
+
+    int visits = 0;
+    int found = 0;
+    while (count > 0) {
+        uint64_t top = heap_pop(heap, &count);
+        int cell = (int)(uint32_t)top;
+        int row = cell / width, col = cell - row * width;
+        int g = autopilot->g[cell];
+        // pushed again since with a better g
+        if ((int)(top >> 32) != g + axis_distance(row, goal_row, height, wrap) + axis_distance(col, goal_col, width, wrap)) {
+            continue;
+        }
+        if (cell == goal) {
+            found = 1;
+            break;
+        }
+        if (visits++ == budget) {
+            autopilot->exhausted++;
+            break;
+        }
+        for (int dir = UP; dir <= RIGHT; dir++) {
+            int next_row, next_col;
+            int next = neighbour(autopilot, row, col, dir, wrap, &next_row, &next_col);
+            if (next < 0 || (autopilot->seen[next] == generation && autopilot->g[next] <= g + 1)) continue;
+            if (!can_enter(autopilot, state, next, next_row, next_col, g + 1, length)) continue;
+            autopilot->seen[next] = generation;
+            autopilot->g[next] = g + 1;
+            autopilot->parent[next] = cell;
+            h = axis_distance(next_row, goal_row, height, wrap) + axis_distance(next_col, goal_col, width, wrap);
+            heap_push(heap, &count, (uint64_t)(g + 1 + h) << 32 | (uint32_t)next);
+        }
+    }
+    autopilot->work += visits;
+    if (!found) return 0;
+
+    int ticks = autopilot->g[goal];
+    for (int cell = goal, i = ticks; i >= 0; cell = autopilot->parent[cell], i--) autopilot->path[i] = cell;
+    autopilot->path_length = ticks + 1;
+    return ticks;
+}
+
+// flood fill from `start`, which the head enters at tick t0 with `length` segments from then on
+// (the cells marked on_path are the body's latest). 1 when the head could chase its tail from
+// there, reaching a cell the body has left, or has room for the whole body; *room counts the
+// cells reached either way
+static int has_room(Autopilot *autopilot, const GameState *state, int start, int t0, int length, int wrap, int budget, int *room) {
+    int width = autopilot->width;
+    int *queue = autopilot->queue;
+    uint32_t generation = autopilot->generation;
+    int head = 0, tail = 0;
+    int visits = 0;
+    int safe = 0;
+
+    autopilot->reached[start] = generation;
+    queue[tail++] = start;
+    // one BFS level per tick
+    for (int t = t0 + 1; head < tail && !safe; t++) {
+        int level_end = tail;
+        while (head < level_end && !safe) {
+            if (visits++ == budget) {
+                autopilot->exhausted++;
+                goto out;
+            }
+            int cell = queue[head++];
+            int row = cell / width, col = cell - row * width;
+            for (int dir = UP; dir <= RIGHT; dir++) {
+                int next_row, next_col;
+                int next = neighbour(autopilot, row, col, dir, wrap, &next_row, &next_col);
+                if (next < 0 || autopilot->reached[next] == generation) continue;
+                if (!can_enter(autopilot, state, next, next_row, next_col, t, length)) continue;
+                autopilot->reached[next] = generation;
+                queue[tail++] = next;
+                if (autopilot->on_path[next] == generation || is_body(state, next_row, next_col) || tail > length) {
+                    safe = 1;
+                    break;
+                }
+            }
+        }
+    }
+out:
+    autopilot->work += visits;
+    *room = tail - 1;
+    return safe;
+}
+
+// after eating at the end of the path, can the head still get out?
+static int path_is_safe(Autopilot *autopilot, const GameState *state, int budget) {
+    int ticks = autopilot->path_length - 1;
+    for (int i = 0; i <= ticks; i++) autopilot->on_path[autopilot->path[i]] = autopilot->generation;
+    int room;
+    int wrap = state->score + 1 >= LEVEL_UPGRADE_SCORE;
+    return has_room(autopilot, state, autopilot->path[ticks], ticks, state->snake.length + 1, wrap, budget, &room);
+}
+
+// the planned path still starts from the head and leads to the food, and no enemy got in the
+// way of the next steps (the body only ever clears off it)
+static int path_is_clear(Autopilot *autopilot, const GameState *state, int head, int food) {
+    if (autopilot->path_length == 0 || autopilot->path_food != food || autopilot->path[autopilot->path_pos] != head) {
+        return 0;
+    }
+    int left = autopilot->path_length - 1 - autopilot->path_pos;
+    if (left < 1) return 0;
+    int ahead = ENEMY_MOVE_INTERVAL * (AUTOPILOT_ENEMY_MOVES + 1);
+    if (ahead > left) ahead = left;
+    for (int t = 1; t <= ahead; t++) {
+        int cell = autopilot->path[autopilot->path_pos + t];
+        int row = cell / autopilot->width, col = cell % autopilot->width;
+        if (!can_enter(autopilot, state, cell, row, col, t, state->snake.length)) return 0;
+    }
+    return 1;
+}
+
+// no safe path to the food: the cycle's next cell when it leaves a way out, else the move with
+// the most room, else any move the body allows
+static int fallback_move(Autopilot *autopilot, const GameState *state, int head, int food, int budget) {
+    int width = autopilot->width;
+    int row = head / width, col = head % width;
+    int wrap = state->score >= LEVEL_UPGRADE_SCORE;
+    int length = state->snake.length;
+    int share = budget / 4 > 0 ? budget / 4 : 1;
+    int best = -1, best_room = -1, risky = -1;
+
+    // candidates: the cycle's successor first, so the cycle wins whenever it is safe
+    int candidates[5];
+    int count = 0;
+    if (autopilot->cycle) candidates[count++] = autopilot->cycle[head];
+    for (int dir = UP; dir <= RIGHT; dir++) {
+        int next_row, next_col;
+        int next = neighbour(autopilot, row, col, dir, wrap, &next_row, &next_col);
+        if (next >= 0) candidates[count++] = next;
+    }
+    for (int i = 0; i < count; i++) {
+        int next = candidates[i];
+        if (i > 0 && autopilot->cycle && next == candidates[0]) continue;
+        int next_row = next / width, next_col = next % width;
+        next_generation(autopilot);
+        if (!body_clear(autopilot, state, next, next_row, next_col, 1, length)) continue;
+        if (in_danger(autopilot, next, 1)) {
+            risky = next;
+            continue;
+        }
+        int eats = next == food;
+        int room;
+        autopilot->on_path[next] = autopilot->generation;
+        autopilot->g[next] = 1;
+        int next_wrap = state->score + eats >= LEVEL_UPGRADE_SCORE;
+        if (has_room(autopilot, state, next, 1, length + eats, next_wrap, share, &room)) return next;
+        if (room > best_room) {
+            best = next;
+            best_room = room;
+        }
+    }
+    return best >= 0 ? best : risky;
+}
+
+/* Autopilot API */
+enum direction autopilot_next(Autopilot *autopilot, const GameState *state) {
+    if (state->snake.length == 0) return state->dir;
+    autopilot->work = 0;
+    sync_body(autopilot, state);
+    predict_enemies(autopilot, state);
+    next_generation(autopilot);
+
+    int head = autopilot->last_head;
+    int food = state->food_x >= 0 ? cell_of(autopilot, state->food_x, state->food_y) : -1;
+    int next = -1;
+    if (path_is_clear(autopilot, state, head, food)) {
+        next = autopilot->path[++autopilot->path_pos];
+        autopilot->reused++;
+    } else {
+        autopilot->path_length = 0;
+        if (food >= 0) {
+            // half the budget to find a path, a quarter to check it, the rest for the fallback
+            autopilot->plans++;
+            if (find_path(autopilot, state, head, food, autopilot->budget / 2) > 0 &&
+                path_is_safe(autopilot, state, autopilot->budget / 4)) {
+                autopilot->path_food = food;
+                autopilot->path_pos = 1;
+                next = autopilot->path[1];
+            } else {
+                autopilot->path_length = 0;
+            }
+        }
+        if (next < 0) {
+            autopilot->fallbacks++;
+            next = fallback_move(autopilot, state, head, food, autopilot->budget - autopilot->work);
+        }
+    }
+    if (autopilot->work > autopilot->max_work) autopilot->max_work = autopilot->work;
+    if (next < 0) return state->dir; // boxed in
+    return direction_to(autopilot, head, next);
+}
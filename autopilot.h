@@ -0,0 +1,68 @@
+#ifndef SNAKE_AUTOPILOT_H
+#define SNAKE_AUTOPILOT_H
+
+/* Built-in player for soak tests. Each tick it either follows the path it
+   planned earlier, after checking the next few steps are still clear, or
+   plans a new one: A* from the head to the food, kept only when a flood fill
+   from the food shows the head could still reach its own tail afterwards.
+   When there is no safe path it falls back to the next cell of a Hamiltonian
+   cycle of the playable area, or failing that to the move with the most room.
+
+   Both searches are time-aware. A body cell opens up once the tail has passed
+   it, so the snake can plan through its own tail, and the enemies' next few
+   moves are predicted from the flow field compute_enemy_position follows, so
+   a cell is only avoided while an enemy could be on it.
+
+   The work of a tick is capped at `budget` cell visits over every search,
+   whatever the snake's length or the board size: a search that runs out
+   gives up and the fallback plays that tick. Counting cells instead of
+   reading a clock keeps the autopilot deterministic. Nothing is allocated
+   after autopilot_init. */
+
+#include <stdint.h>
+#include "game.h"
+
+#define AUTOPILOT_DEFAULT_BUDGET 8192 // cell visits per tick, enough for whole searches on the default board
+#define AUTOPILOT_ENEMY_MOVES 4       // enemy moves predicted ahead
+
+typedef struct {
+    Arena arena;                 // Every array below, sized for the playable area
+    int width, height;           // Playable area, the walls excluded
+    int budget;                  // Cell visits a tick may make
+    int *cycle;                  // Next cell on the Hamiltonian cycle, NULL when both sides are odd
+    int *slot;                   // Ring slot of the body segment on each cell, valid for body cells
+    int last_head;               // Head cell at the previous tick, -1 to walk the body again
+    uint32_t generation;         // Stamp of the current search
+    uint32_t danger_generation;  // Stamp of this tick's enemy prediction
+    uint32_t *seen;              // A*: g and parent of a cell are valid when stamped
+    uint32_t *reached;           // Flood fill: visited when stamped
+    uint32_t *on_path;           // Cell is on the path being checked when stamped
+    uint32_t *danger;            // An enemy may be on the cell during [danger_from, danger_until] when stamped
+    int32_t *g;                  // Ticks for the head to reach a cell
+    int *parent;                 // Cell the head reaches a cell from
+    uint64_t *heap;              // A* open list, (f << 32 | cell)
+    int *queue;                  // Flood fill queue
+    int16_t *danger_from, *danger_until; // Ticks from now
+    int *path;                   // Cells from where the path was planned to the food
+    int path_length;             // Cells in path, 0 when there is none
+    int path_pos;                // Index of the cell the head should be on
+    int path_food;               // Food cell the path leads to
+    int work;                    // Cell visits made this tick
+    int max_work;                // Most cell visits made in one tick
+    long long plans;             // A* searches run
+    long long reused;            // Ticks played from an earlier path
+    long long fallbacks;         // Ticks played without a path to the food
+    long long exhausted;         // Searches stopped by the budget
+} Autopilot;
+
+// room for games shaped like `state`; budget <= 0 takes AUTOPILOT_DEFAULT_BUDGET
+void autopilot_init(Autopilot *autopilot, const GameState *state, int budget);
+void autopilot_free(Autopilot *autopilot);
+
+// forget the path and walk the body again at the next tick: the game was reset or rewound
+void autopilot_reset(Autopilot *autopilot);
+
+// the move to make before the next tick
+enum direction autopilot_next(Autopilot *autopilot, const GameState *state);
+
+#endif
@@ -0,0 +1,100 @@
+#include "bitboard.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+size_t board_arena_size(int rows, int cols) {
+    return ARENA_SIZE((size_t)rows * ((cols + 63) / 64) * sizeof(uint64_t));
+}
+
+void board_init(Bitboard *board, Arena *arena, int rows, int cols) {
+    board->rows = rows;
+    board->cols = cols;
+    board->row_words = (cols + 63) / 64;
+    board->size = rows * board->row_words;
+    board->words = arena_alloc(arena, (size_t)board->size * sizeof(uint64_t));
+}
+
+// valid bits of each word in a row: everything but the padding past the last column
+static inline uint64_t row_word_mask(const Bitboard *board, int word) {
+    int bits = board->cols - word * 64;
+    return bits >= 64 ? ~0ULL : (1ULL << bits) - 1;
+}
+
+void board_union(const Bitboard *boards, int count_boards, int first, int count, uint64_t *out) {
+    int i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= count; i += 4) {
+        __m256i acc = _mm256_loadu_si256((const __m256i *)&boards[0].words[first + i]);
+        for (int b = 1; b < count_boards; b++) {
+            acc = _mm256_or_si256(acc, _mm256_loadu_si256((const __m256i *)&boards[b].words[first + i]));
+        }
+        _mm256_storeu_si256((__m256i *)&out[i], acc);
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    for (; i + 2 <= count; i += 2) {
+        __m128i acc = _mm_loadu_si128((const __m128i *)&boards[0].words[first + i]);
+        for (int b = 1; b < count_boards; b++) {
+            acc = _mm_or_si128(acc, _mm_loadu_si128((const __m128i *)&boards[b].words[first + i]));
+        }
+        _mm_storeu_si128((__m128i *)&out[i], acc);
+    }
+#endif
+    for (; i < count; i++) {
+        uint64_t acc = boards[0].words[first + i];
+        for (int b = 1; b < count_boards; b++) acc |= boards[b].words[first + i];
+        out[i] = acc;
+    }
+}
+
+int board_count_free(const Bitboard *boards, int count) {
+    uint64_t occupied[BOARD_CHUNK_WORDS];
+    const Bitboard *shape = &boards[0];
+    int free_cells = 0;
+    int column_word = 0; // position of the current word in its row
+    for (int first = 0; first < shape->size; first += BOARD_CHUNK_WORDS) {
+        int n = shape->size - first < BOARD_CHUNK_WORDS ? shape->size - first : BOARD_CHUNK_WORDS;
+        board_union(boards, count, first, n, occupied);
+        for (int i = 0; i < n; i++) {
+            free_cells += popcount64(~occupied[i] & row_word_mask(shape, column_word));
+            if (++column_word == shape->row_words) column_word = 0;
+        }
+    }
+    return free_cells;
+}
+
+// position of the nth set bit of a word
+static inline int select64(uint64_t word, int n) {
+#if defined(__BMI2__)
+    return ctz64(_pdep_u64(1ULL << n, word));
+#else
+    while (n-- > 0) word &= word - 1; // drop the lowest set bits
+    return ctz64(word);
+#endif
+}
+
+int board_nth_free(const Bitboard *boards, int count, int n) {
+    uint64_t occupied[BOARD_CHUNK_WORDS];
+    const Bitboard *shape = &boards[0];
+    int row = 0, column_word = 0;
+    for (int first = 0; first < shape->size; first += BOARD_CHUNK_WORDS) {
+        int chunk = shape->size - first < BOARD_CHUNK_WORDS ? shape->size - first : BOARD_CHUNK_WORDS;
+        board_union(boards, count, first, chunk, occupied);
+        for (int i = 0; i < chunk; i++) {
+            uint64_t free_bits = ~occupied[i] & row_word_mask(shape, column_word);
+            int bits = popcount64(free_bits);
+            if (n < bits) return row * shape->cols + column_word * 64 + select64(free_bits, n);
+            n -= bits;
+            if (++column_word == shape->row_words) {
+                column_word = 0;
+                row++;
+            }
+        }
+    }
+    return -1;
+}
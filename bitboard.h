@@ -0,0 +1,71 @@
+#ifndef SNAKE_BITBOARD_H
+#define SNAKE_BITBOARD_H
+
+/* One bit per cell, rows packed into 64-bit words. The simulation keeps one
+   board per entity type; collisions are single bit tests and whole-board
+   queries (free cell count, nth free cell) OR the boards together and count
+   bits a word (or a SIMD register) at a time. */
+
+#include <stdint.h>
+#include "arena.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define BOARD_CHUNK_WORDS 256 // words OR-ed together per pass of the whole-board queries
+
+typedef struct {
+    uint64_t *words;             // Row-major, bits past `cols` in a row stay 0
+    int rows, cols;              // Cells
+    int row_words;               // Words per row
+    int size;                    // rows * row_words
+} Bitboard;
+
+// bytes board_init takes from an arena
+size_t board_arena_size(int rows, int cols);
+void board_init(Bitboard *board, Arena *arena, int rows, int cols);
+
+static inline int board_word(const Bitboard *board, int row, int col) {
+    return row * board->row_words + (col >> 6);
+}
+
+static inline int board_test(const Bitboard *board, int row, int col) {
+    return (int)((board->words[board_word(board, row, col)] >> (col & 63)) & 1);
+}
+
+static inline void board_set(Bitboard *board, int row, int col) {
+    board->words[board_word(board, row, col)] |= 1ULL << (col & 63);
+}
+
+static inline void board_clear(Bitboard *board, int row, int col) {
+    board->words[board_word(board, row, col)] &= ~(1ULL << (col & 63));
+}
+
+static inline int popcount64(uint64_t x) {
+#if defined(_MSC_VER)
+    return (int)__popcnt64(x);
+#else
+    return __builtin_popcountll(x);
+#endif
+}
+
+static inline int ctz64(uint64_t x) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return (int)index;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+// OR of words [first, first + count) of `count_boards` boards of the same size into out
+void board_union(const Bitboard *boards, int count_boards, int first, int count, uint64_t *out);
+
+// cells not set in any of the `count` boards
+int board_count_free(const Bitboard *boards, int count);
+
+// row * cols + col of the nth (0-based) free cell in row-major order, -1 if there are fewer
+int board_nth_free(const Bitboard *boards, int count, int n);
+
+#endif
@@ -0,0 +1,499 @@
+#if defined(__linux__)
+#define _GNU_SOURCE // accept4, MSG_NOSIGNAL
+#endif
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "broadcast.h"
+#include "term.h"
+
+#if defined(__linux__)
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define BROADCAST_SLOTS 3
+#define BROADCAST_FRESH 4           // set in `middle` until the broadcaster takes the frame
+#define BROADCAST_EVENTS 64         // epoll events handled per wake-up
+#define LISTEN_TAG BROADCAST_MAX_SPECTATORS
+#define WAKE_TAG (BROADCAST_MAX_SPECTATORS + 1)
+
+// a keyframe may land in the middle of an escape sequence a lapped spectator got half of:
+// CAN aborts it, then the colour is reset before the full repaint
+static const char keyframe_prefix[] = "\x18" COLOR_RESET;
+
+typedef struct {
+    uint64_t start;              // Ring position of the first byte, counting from the first frame
+    uint32_t length;
+    int key;                     // A full repaint, only sent to spectators that wait for one
+} Record;
+
+typedef struct {
+    int fd;                      // -1 for a free slot
+    uint64_t record;             // Next record to send
+    uint32_t offset;             // Bytes of it already sent
+    int waiting;                 // Joined or lapped: gets nothing until the next keyframe
+    int keyed;                   // `record` is its keyframe, not one to skip
+    int blocked;                 // Socket full, waiting for EPOLLOUT
+} Spectator;
+
+struct BroadcastState {
+    Arena arena;                 // Frame slots and the ring
+    char *slots[BROADCAST_SLOTS];
+    int scores[BROADCAST_SLOTS];
+    int write;                   // Game thread's slot
+    int read;                    // Broadcaster's slot, the last frame composed
+    int have_frame;              // read holds a frame
+    atomic_int middle;           // Slot between the threads, | BROADCAST_FRESH until taken
+    atomic_int stop;
+    atomic_int waiting;          // The broadcaster is about to sleep, publish has to wake it
+    int wake_fd;                 // eventfd, in the epoll set
+    int listen_fd;
+    int epoll_fd;
+    pthread_t thread;
+    char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    Renderer delta;              // Composes each frame against the one before
+    Renderer key;                // Composes keyframes, repainting everything
+    char *ring;
+    uint64_t ring_size;
+    uint64_t ring_pos;           // Bytes ever appended, padding included
+    Record records[BROADCAST_RECORDS];
+    uint64_t record_count;       // Records ever appended
+    Spectator spectators[BROADCAST_MAX_SPECTATORS];
+    int spectator_slots;         // High-water mark of the slots in use
+    int need_key;                // A spectator waits for a keyframe
+    Broadcast *owner;            // Counters, written by the broadcaster only
+};
+
+/* Ring */
+static void append(BroadcastState *state, const char *prefix, size_t prefix_len,
+                   const char *bytes, size_t len, int key) {
+    size_t total = prefix_len + len;
+    uint64_t offset = state->ring_pos % state->ring_size;
+    // records never wrap, so each one goes out as a single piece
+    if (offset + total > state->ring_size) {
+        state->ring_pos += state->ring_size - offset;
+        offset = 0;
+    }
+    memcpy(state->ring + offset, prefix, prefix_len);
+    memcpy(state->ring + offset + prefix_len, bytes, len);
+    Record *record = &state->records[state->record_count % BROADCAST_RECORDS];
+    record->start = state->ring_pos;
+    record->length = (uint32_t)total;
+    record->key = key;
+    state->ring_pos += total;
+    state->record_count++;
+}
+
+// the record was overwritten, or its slot in the index reused, since the spectator got there
+static int lapped(const BroadcastState *state, uint64_t index) {
+    if (index >= state->record_count) return 0;
+    if (index + BROADCAST_RECORDS < state->record_count) return 1;
+    return state->records[index % BROADCAST_RECORDS].start + state->ring_size < state->ring_pos;
+}
+
+/* Spectators */
+static void watch_events(BroadcastState *state, int slot, int writable) {
+    struct epoll_event event;
+    event.events = EPOLLIN | (writable ? EPOLLOUT : 0);
+    event.data.u32 = (uint32_t)slot;
+    epoll_ctl(state->epoll_fd, EPOLL_CTL_MOD, state->spectators[slot].fd, &event);
+}
+
+static void drop_spectator(BroadcastState *state, int slot) {
+    Spectator *spectator = &state->spectators[slot];
+    close(spectator->fd); // also leaves the epoll set
+    spectator->fd = -1;
+    state->owner->spectators--;
+}
+
+// keyframes are skipped unless the spectator is waiting on that very one
+static void skip_keys(const BroadcastState *state, Spectator *spectator) {
+    while (spectator->record < state->record_count && !spectator->keyed &&
+           state->records[spectator->record % BROADCAST_RECORDS].key) {
+        spectator->record++;
+    }
+}
+
+// send as much of the ring as the socket takes right now
+static void flush_spectator(BroadcastState *state, int slot) {
+    Spectator *spectator = &state->spectators[slot];
+    for (;;) {
+        if (spectator->fd < 0 || spectator->waiting) return;
+        skip_keys(state, spectator);
+        if (lapped(state, spectator->record)) {
+            // whatever it missed is gone: it starts over from the next keyframe
+            spectator->waiting = 1;
+            spectator->keyed = 0;
+            state->need_key = 1;
+            state->owner->lapped++;
+            return;
+        }
+
+        struct iovec iov[BROADCAST_IOV];
+        int count = 0;
+        uint32_t offset = spectator->offset;
+        for (uint64_t r = spectator->record; r < state->record_count && count < BROADCAST_IOV; r++) {
+            const Record *record = &state->records[r % BROADCAST_RECORDS];
+            if (record->key && !(r == spectator->record && spectator->keyed)) continue;
+            iov[count].iov_base = state->ring + record->start % state->ring_size + offset;
+            iov[count].iov_len = record->length - offset;
+            offset = 0;
+            count++;
+        }
+        if (count == 0) {
+            if (spectator->blocked) {
+                spectator->blocked = 0;
+                watch_events(state, slot, 0);
+            }
+            return;
+        }
+
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = iov;
+        message.msg_iovlen = (size_t)count;
+        ssize_t sent = sendmsg(spectator->fd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (!spectator->blocked) {
+                    spectator->blocked = 1;
+                    watch_events(state, slot, 1);
+                }
+            } else if (errno != EINTR) {
+                drop_spectator(state, slot);
+            }
+            return;
+        }
+
+        // move the cursor over what went out, the same records the iovecs were built from
+        size_t left = (size_t)sent;
+        while (left > 0) {
+            const Record *record = &state->records[spectator->record % BROADCAST_RECORDS];
+            size_t rest = record->length - spectator->offset;
+            if (left < rest) {
+                spectator->offset += (uint32_t)left;
+                break;
+            }
+            left -= rest;
+            spectator->record++;
+            spectator->offset = 0;
+            spectator->keyed = 0;
+            skip_keys(state, spectator);
+        }
+    }
+}
+
+// a full repaint of the last frame for every spectator waiting on one
+static void send_keyframe(BroadcastState *state) {
+    if (!state->have_frame) return; // the first frame will do
+    state->need_key = 0;
+    renderer_invalidate(&state->key);
+    size_t len = render_glyphs(&state->key, state->slots[state->read], state->scores[state->read]);
+    uint64_t index = state->record_count;
+    append(state, keyframe_prefix, sizeof(keyframe_prefix) - 1, state->key.frame, len, 1);
+    state->owner->keyframes++;
+    for (int slot = 0; slot < state->spectator_slots; slot++) {
+        Spectator *spectator = &state->spectators[slot];
+        if (spectator->fd < 0 || !spectator->waiting) continue;
+        spectator->record = index;
+        spectator->offset = 0;
+        spectator->waiting = 0;
+        spectator->keyed = 1;
+        flush_spectator(state, slot);
+    }
+}
+
+static void accept_spectators(BroadcastState *state) {
+    for (;;) {
+        int fd = accept4(state->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+        int slot = 0;
+        while (slot < state->spectator_slots && state->spectators[slot].fd >= 0) slot++;
+        if (slot == BROADCAST_MAX_SPECTATORS) {
+            close(fd);
+            continue;
+        }
+        if (slot == state->spectator_slots) state->spectator_slots++;
+
+        Spectator *spectator = &state->spectators[slot];
+        memset(spectator, 0, sizeof(*spectator));
+        spectator->fd = fd;
+        spectator->waiting = 1;
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u32 = (uint32_t)slot;
+        if (epoll_ctl(state->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            close(fd);
+            spectator->fd = -1;
+            continue;
+        }
+        state->need_key = 1;
+        Broadcast *owner = state->owner;
+        if (++owner->spectators > owner->peak_spectators) owner->peak_spectators = owner->spectators;
+    }
+}
+
+// spectators never send anything: readable means gone
+static void read_spectator(BroadcastState *state, int slot) {
+    char buf[256];
+    ssize_t got = recv(state->spectators[slot].fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        drop_spectator(state, slot);
+    }
+}
+
+/* Broadcaster thread */
+// the eventfd counter only has to be non-zero: a failed write means it already is
+static void wake(BroadcastState *state) {
+    uint64_t one = 1;
+    ssize_t written = write(state->wake_fd, &one, sizeof(one));
+    (void)written;
+}
+
+// swap the broadcaster's slot for the middle one when it holds a frame not composed yet
+static int take_frame(BroadcastState *state) {
+    if (!(atomic_load(&state->middle) & BROADCAST_FRESH)) return 0;
+    state->read = atomic_exchange(&state->middle, state->read) & ~BROADCAST_FRESH;
+    state->have_frame = 1;
+    return 1;
+}
+
+// one delta for every spectator, then each gets as much of the ring as its socket takes
+static void compose_frame(BroadcastState *state) {
+    size_t len = render_glyphs(&state->delta, state->slots[state->read], state->scores[state->read]);
+    if (len > 0) append(state, "", 0, state->delta.frame, len, 0);
+    state->owner->composed++;
+    for (int slot = 0; slot < state->spectator_slots; slot++) {
+        if (!state->spectators[slot].blocked) flush_spectator(state, slot);
+    }
+}
+
+static void *broadcast_main(void *arg) {
+    BroadcastState *state = arg;
+    struct epoll_event events[BROADCAST_EVENTS];
+    for (;;) {
+        // checked before taking the frame, so the one published right before stop goes out
+        int stop = atomic_load(&state->stop);
+        if (take_frame(state)) compose_frame(state);
+        else if (stop) break;
+        if (state->need_key) send_keyframe(state);
+
+        // announce the sleep, then look once more, as the render thread does
+        atomic_store(&state->waiting, 1);
+        int idle = !(atomic_load(&state->middle) & BROADCAST_FRESH) && !atomic_load(&state->stop);
+        int count = epoll_wait(state->epoll_fd, events, BROADCAST_EVENTS, idle ? -1 : 0);
+        atomic_store(&state->waiting, 0);
+
+        for (int i = 0; i < count; i++) {
+            uint32_t tag = events[i].data.u32;
+            if (tag == LISTEN_TAG) {
+                accept_spectators(state);
+            } else if (tag == WAKE_TAG) {
+                uint64_t value;
+                if (read(state->wake_fd, &value, sizeof(value)) < 0) continue;
+            } else if (state->spectators[tag].fd >= 0) {
+                if (events[i].events & (EPOLLHUP | EPOLLERR)) drop_spectator(state, (int)tag);
+                else if (events[i].events & EPOLLIN) read_spectator(state, (int)tag);
+                if (state->spectators[tag].fd >= 0 && (events[i].events & EPOLLOUT)) {
+                    flush_spectator(state, (int)tag);
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Socket */
+static int listen_on(const char *path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        // a socket left behind by a game that crashed: nobody answers on it, take it over
+        int probe = errno == EADDRINUSE ? socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) : -1;
+        int stale = probe >= 0 && connect(probe, (struct sockaddr *)&address, sizeof(address)) < 0 &&
+                    errno == ECONNREFUSED;
+        if (probe >= 0) close(probe);
+        if (!stale || unlink(path) < 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+            if (!stale) errno = EADDRINUSE;
+            close(fd);
+            return -1;
+        }
+    }
+    if (listen(fd, SOMAXCONN) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Broadcast API */
+int broadcast_start(Broadcast *broadcast, const char *path, int rows, int cols) {
+    memset(broadcast, 0, sizeof(*broadcast));
+    if (strlen(path) >= sizeof(((struct sockaddr_un *)0)->sun_path)) {
+        errno = ENAMETOOLONG;
+        return 0;
+    }
+    size_t area = (size_t)rows * cols;
+    BroadcastState *state = calloc(1, sizeof(BroadcastState));
+    if (!state) return 0;
+    state->owner = broadcast;
+    renderer_init(&state->delta, 0, rows, cols);
+    renderer_init(&state->key, 0, rows, cols);
+    state->ring_size = BROADCAST_RING_FRAMES * (uint64_t)(state->delta.frame_max + sizeof(keyframe_prefix));
+    arena_init(&state->arena, BROADCAST_SLOTS * ARENA_SIZE(area) + ARENA_SIZE(state->ring_size));
+    for (int i = 0; i < BROADCAST_SLOTS; i++) state->slots[i] = ARENA_NEW(&state->arena, char, area);
+    state->ring = ARENA_NEW(&state->arena, char, state->ring_size);
+    for (int i = 0; i < BROADCAST_MAX_SPECTATORS; i++) state->spectators[i].fd = -1;
+    // slot 0 is the game thread's, 1 the broadcaster's and 2 starts in the middle
+    state->write = 0;
+    state->read = 1;
+    atomic_init(&state->middle, 2);
+    atomic_init(&state->stop, 0);
+    atomic_init(&state->waiting, 0);
+    strcpy(state->path, path);
+
+    state->listen_fd = listen_on(path);
+    state->wake_fd = state->listen_fd < 0 ? -1 : eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    state->epoll_fd = state->wake_fd < 0 ? -1 : epoll_create1(EPOLL_CLOEXEC);
+    int ok = state->epoll_fd >= 0;
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = LISTEN_TAG;
+    ok = ok && epoll_ctl(state->epoll_fd, EPOLL_CTL_ADD, state->listen_fd, &event) == 0;
+    event.data.u32 = WAKE_TAG;
+    ok = ok && epoll_ctl(state->epoll_fd, EPOLL_CTL_ADD, state->wake_fd, &event) == 0;
+    ok = ok && pthread_create(&state->thread, NULL, broadcast_main, state) == 0;
+    if (!ok) {
+        int error = errno;
+        if (state->epoll_fd >= 0) close(state->epoll_fd);
+        if (state->wake_fd >= 0) close(state->wake_fd);
+        if (state->listen_fd >= 0) {
+            close(state->listen_fd);
+            unlink(path);
+        }
+        renderer_free(&state->delta);
+        renderer_free(&state->key);
+        arena_free(&state->arena);
+        free(state);
+        errno = error;
+        return 0;
+    }
+    broadcast->state = state;
+    return 1;
+}
+
+void broadcast_publish(Broadcast *broadcast, const char *glyphs, int score) {
+    BroadcastState *state = broadcast->state;
+    memcpy(state->slots[state->write], glyphs, (size_t)state->delta.rows * state->delta.cols);
+    state->scores[state->write] = score;
+    state->write = atomic_exchange(&state->middle, state->write | BROADCAST_FRESH) & ~BROADCAST_FRESH;
+    broadcast->published++;
+    // while the broadcaster is busy it finds the frame on its own, no system call
+    if (atomic_load(&state->waiting)) wake(state);
+}
+
+void broadcast_stop(Broadcast *broadcast) {
+    BroadcastState *state = broadcast->state;
+    if (!state) return;
+    atomic_store(&state->stop, 1);
+    wake(state);
+    pthread_join(state->thread, NULL);
+
+    for (int slot = 0; slot < state->spectator_slots; slot++) {
+        if (state->spectators[slot].fd >= 0) drop_spectator(state, slot);
+    }
+    close(state->epoll_fd);
+    close(state->wake_fd);
+    close(state->listen_fd);
+    unlink(state->path);
+    renderer_free(&state->delta);
+    renderer_free(&state->key);
+    arena_free(&state->arena);
+    free(state);
+    broadcast->state = NULL;
+}
+
+/* Spectator client */
+int broadcast_watch(const char *path) {
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return 0;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return 0;
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return 0;
+    }
+
+    term_enable_raw_mode(); // Ctrl-Q instead of a signal, like the game
+    char buf[65536];
+    int keys[16];
+    int watching = 1;
+    while (watching) {
+        struct pollfd fds[2] = { { fd, POLLIN, 0 }, { STDIN_FILENO, POLLIN, 0 } };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[0].revents) {
+            ssize_t got = read(fd, buf, sizeof(buf));
+            if (got <= 0) break; // the game is over
+            term_write(buf, (size_t)got);
+        }
+        if (fds[1].revents) {
+            int count = term_read_keys(keys, 16);
+            for (int i = 0; i < count; i++) {
+                if (keys[i] == CTRL_KEY('q')) watching = 0;
+            }
+        }
+    }
+    close(fd);
+    static const char restore[] = COLOR_RESET ESC "[?25h\r\n";
+    term_write(restore, sizeof(restore) - 1);
+    return 1;
+}
+#else
+/* Other platforms: no epoll, no broadcast */
+int broadcast_start(Broadcast *broadcast, const char *path, int rows, int cols) {
+    (void)path;
+    (void)rows;
+    (void)cols;
+    memset(broadcast, 0, sizeof(*broadcast));
+    errno = ENOSYS;
+    return 0;
+}
+
+void broadcast_publish(Broadcast *broadcast, const char *glyphs, int score) {
+    (void)broadcast;
+    (void)glyphs;
+    (void)score;
+}
+
+void broadcast_stop(Broadcast *broadcast) {
+    (void)broadcast;
+}
+
+int broadcast_watch(const char *path) {
+    (void)path;
+    errno = ENOSYS;
+    return 0;
+}
+#endif
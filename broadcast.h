@@ -0,0 +1,49 @@
+#ifndef SNAKE_BROADCAST_H
+#define SNAKE_BROADCAST_H
+
+/* Spectator broadcast: `snake --broadcast <socket>` streams the game over a
+   Unix socket to any number of `snake --watch <socket>` clients on the same
+   machine. Linux only (epoll); elsewhere broadcast_start and broadcast_watch
+   fail with ENOSYS.
+
+   The game thread copies each frame's glyphs into a triple buffer: one memcpy
+   and one atomic exchange, whatever the number of spectators. A broadcaster
+   thread composes the delta against the frame before once, appends it to a
+   ring of encoded frames every spectator reads from at its own position, and
+   fans it out from an epoll loop with nonblocking writes. A spectator too slow
+   to keep up is lapped by the ring: it drops the deltas it missed and resumes
+   from a keyframe, a full repaint composed only when somebody needs one. No
+   spectator ever makes the game or the other spectators wait. */
+
+#include "render.h"
+
+#define BROADCAST_RING_FRAMES 32   // worst-case frames the ring holds before lapping a spectator
+#define BROADCAST_RECORDS 4096     // frames (deltas and keyframes) indexed in the ring
+#define BROADCAST_MAX_SPECTATORS 1024
+#define BROADCAST_IOV 64           // ring records sent per system call
+
+typedef struct BroadcastState BroadcastState;
+
+typedef struct {
+    BroadcastState *state;       // Threads, sockets and the ring, NULL when not broadcasting
+    long long published;         // Frames handed over by the game thread
+    long long composed;          // Frames the broadcaster turned into a delta
+    long long keyframes;         // Full repaints composed for joining or lapped spectators
+    long long lapped;            // Times a spectator fell a whole ring behind
+    int spectators;              // Connected now, the broadcaster's count
+    int peak_spectators;
+} Broadcast;
+
+// listen on `path` and start the broadcaster for a rows x cols board, 0 with errno set on failure
+int broadcast_start(Broadcast *broadcast, const char *path, int rows, int cols);
+
+// hand a frame's glyphs to the broadcaster, never blocks
+void broadcast_publish(Broadcast *broadcast, const char *glyphs, int score);
+
+// send the last frame, disconnect every spectator and remove the socket
+void broadcast_stop(Broadcast *broadcast);
+
+// show the stream from `path` until it ends or Ctrl-Q, 0 with errno set when it can't connect
+int broadcast_watch(const char *path);
+
+#endif
@@ -0,0 +1,282 @@
+#include <string.h>
+#include <time.h>
+#include "cast.h"
+#include "term.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+
+#define CAST_MIN_WIDTH 80 // the HUD's help line is wider than the smallest boards
+
+/* Threads */
+#ifdef _WIN32
+struct CastSync {
+    volatile LONG head;          // Frames published, the game thread's index
+    volatile LONG tail;          // Frames written, the writer thread's index
+    volatile LONG stop;
+    volatile LONG waiting;       // The writer is about to sleep, publish has to wake it
+    HANDLE wake;                 // Auto-reset event: a publish never blocks on the writer
+    HANDLE thread;
+};
+
+// a compare-exchange that never matches is a load with a barrier
+static unsigned load_index(volatile LONG *index) {
+    return (unsigned)InterlockedCompareExchange(index, -1, -1);
+}
+
+static void store_index(volatile LONG *index, unsigned value) {
+    InterlockedExchange(index, (LONG)value);
+}
+
+static int stopping(CastSync *sync) {
+    return (int)InterlockedCompareExchange(&sync->stop, -1, -1);
+}
+
+static void set_waiting(CastSync *sync, int waiting) {
+    InterlockedExchange(&sync->waiting, waiting);
+}
+
+static int is_waiting(CastSync *sync) {
+    return (int)InterlockedCompareExchange(&sync->waiting, -1, -1);
+}
+
+static void wake(CastSync *sync) {
+    SetEvent(sync->wake);
+}
+
+static void sleep_until_woken(CastSync *sync) {
+    WaitForSingleObject(sync->wake, INFINITE);
+}
+#else
+struct CastSync {
+    atomic_uint head;            // Frames published, the game thread's index
+    atomic_uint tail;            // Frames written, the writer thread's index
+    atomic_int stop;
+    atomic_int waiting;          // The writer is about to sleep, publish has to wake it
+    pthread_mutex_t lock;        // Guards woken for the sleep, never the queue
+    pthread_cond_t wake;
+    int woken;
+    pthread_t thread;
+};
+
+// sequentially consistent, as in presenter.c: a publish and the writer going to sleep each
+// write one value and read the other's, and at least one of them has to see the other's write
+static unsigned load_index(atomic_uint *index) {
+    return atomic_load(index);
+}
+
+static void store_index(atomic_uint *index, unsigned value) {
+    atomic_store(index, value);
+}
+
+static int stopping(CastSync *sync) {
+    return atomic_load_explicit(&sync->stop, memory_order_acquire);
+}
+
+static void set_waiting(CastSync *sync, int waiting) {
+    atomic_store(&sync->waiting, waiting);
+}
+
+static int is_waiting(CastSync *sync) {
+    return atomic_load(&sync->waiting);
+}
+
+static void wake(CastSync *sync) {
+    pthread_mutex_lock(&sync->lock);
+    sync->woken = 1;
+    pthread_cond_signal(&sync->wake);
+    pthread_mutex_unlock(&sync->lock);
+}
+
+static void sleep_until_woken(CastSync *sync) {
+    pthread_mutex_lock(&sync->lock);
+    while (!sync->woken) pthread_cond_wait(&sync->wake, &sync->lock);
+    sync->woken = 0;
+    pthread_mutex_unlock(&sync->lock);
+}
+#endif
+
+/* Events */
+// worst case of a JSON-escaped byte: \u00XX
+#define ESCAPED_MAX 6
+#define EVENT_OVERHEAD 64 // [seconds, "o", "..."] and the newline
+
+static char *put_escaped(char *p, const char *bytes, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)bytes[i];
+        if (c == '"' || c == '\\') {
+            *p++ = '\\';
+            *p++ = (char)c;
+        } else if (c == '\n') {
+            *p++ = '\\';
+            *p++ = 'n';
+        } else if (c < 0x20 || c == 0x7f) {
+            memcpy(p, "\\u00", 4);
+            p[4] = hex[c >> 4];
+            p[5] = hex[c & 15];
+            p += 6;
+        } else {
+            *p++ = (char)c;
+        }
+    }
+    return p;
+}
+
+static void write_event(Cast *cast, int64_t time, const char *bytes, size_t len) {
+    if (cast->failed) return;
+    char *p = cast->event + sprintf(cast->event, "[%.6f, \"o\", \"", (time - cast->start) / 1e9);
+    p = put_escaped(p, bytes, len);
+    memcpy(p, "\"]\n", 3);
+    size_t size = (size_t)(p + 3 - cast->event);
+    if (fwrite(cast->event, 1, size, cast->file) != size) cast->failed = 1;
+    cast->bytes += (long long)size;
+}
+
+// the changes since the last frame written, nothing when there are none
+static void write_frame(Cast *cast, const CastFrame *frame) {
+    size_t len = render_glyphs(&cast->renderer, frame->glyphs, frame->score);
+    if (len > 0) {
+        write_event(cast, frame->time, cast->renderer.frame, len);
+        cast->written++;
+    }
+}
+
+/* Writer thread */
+static void writer_loop(Cast *cast) {
+    CastSync *sync = cast->sync;
+    unsigned tail = load_index(&sync->tail);
+    for (;;) {
+        // checked before looking at the queue, so frames published right before stop are written
+        int stop = stopping(sync);
+        if (tail != load_index(&sync->head)) {
+            write_frame(cast, &cast->slots[tail % CAST_QUEUE_SLOTS]);
+            store_index(&sync->tail, ++tail);
+        } else if (stop) {
+            break;
+        } else {
+            // announce the sleep, then look once more: a frame published in between either
+            // shows up here or sees the flag and wakes us
+            set_waiting(sync, 1);
+            if (tail == load_index(&sync->head) && !stopping(sync)) sleep_until_woken(sync);
+            set_waiting(sync, 0);
+        }
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI writer_main(LPVOID arg) {
+    writer_loop(arg);
+    return 0;
+}
+#else
+static void *writer_main(void *arg) {
+    writer_loop(arg);
+    return NULL;
+}
+#endif
+
+/* Cast API */
+int cast_start(Cast *cast, const char *path, int rows, int cols) {
+    memset(cast, 0, sizeof(*cast));
+    cast->file = fopen(path, "wb");
+    if (!cast->file) return 0;
+
+    renderer_init(&cast->renderer, 0, rows, cols);
+    size_t area = (size_t)rows * cols;
+    size_t event_max = cast->renderer.frame_max * ESCAPED_MAX + EVENT_OVERHEAD;
+    arena_init(&cast->arena, (CAST_QUEUE_SLOTS + 1) * ARENA_SIZE(area) + ARENA_SIZE(event_max) +
+                             ARENA_SIZE(CAST_BUFFER_SIZE) + ARENA_SIZE(sizeof(CastSync)));
+    for (int i = 0; i < CAST_QUEUE_SLOTS; i++) cast->slots[i].glyphs = ARENA_NEW(&cast->arena, char, area);
+    cast->pending.glyphs = ARENA_NEW(&cast->arena, char, area);
+    cast->event = ARENA_NEW(&cast->arena, char, event_max);
+    cast->file_buffer = ARENA_NEW(&cast->arena, char, CAST_BUFFER_SIZE);
+    setvbuf(cast->file, cast->file_buffer, _IOFBF, CAST_BUFFER_SIZE);
+
+    // the frames start on the second line and the HUD ends one line above the bottom
+    int width = cols > CAST_MIN_WIDTH ? cols : CAST_MIN_WIDTH;
+    int height = cast->renderer.hud_row + HUD_LINES;
+    int len = fprintf(cast->file, "{\"version\": 2, \"width\": %d, \"height\": %d, \"timestamp\": %lld, "
+                      "\"env\": {\"TERM\": \"xterm-256color\"}}\n", width, height, (long long)time(NULL));
+    if (len < 0) cast->failed = 1;
+    else cast->bytes = len;
+    cast->start = term_now_ns();
+    write_event(cast, cast->start, ESC "[?25l", 6); // the player's cursor is hidden too
+
+    CastSync *sync = ARENA_NEW(&cast->arena, CastSync, 1);
+    cast->sync = sync;
+#ifdef _WIN32
+    sync->wake = CreateEventA(NULL, FALSE, FALSE, NULL);
+    if (!sync->wake) die("CreateEvent");
+    sync->thread = CreateThread(NULL, 0, writer_main, cast, 0, NULL);
+    if (!sync->thread) die("CreateThread");
+#else
+    atomic_init(&sync->head, 0);
+    atomic_init(&sync->tail, 0);
+    atomic_init(&sync->stop, 0);
+    atomic_init(&sync->waiting, 0);
+    pthread_mutex_init(&sync->lock, NULL);
+    pthread_cond_init(&sync->wake, NULL);
+    if (pthread_create(&sync->thread, NULL, writer_main, cast)) die("pthread_create");
+#endif
+    return 1;
+}
+
+void cast_publish(Cast *cast, const char *glyphs, int score) {
+    CastSync *sync = cast->sync;
+    size_t area = (size_t)cast->renderer.rows * cast->renderer.cols;
+    int64_t now = term_now_ns();
+    // only this thread moves head, the writer only ever frees slots
+    unsigned head = load_index(&sync->head);
+    cast->published++;
+
+    // full: keep the frame aside, the next one that fits carries its changes anyway
+    if (head - load_index(&sync->tail) == CAST_QUEUE_SLOTS) {
+        memcpy(cast->pending.glyphs, glyphs, area);
+        cast->pending.score = score;
+        cast->pending.time = now;
+        cast->has_pending = 1;
+        cast->dropped++;
+        return;
+    }
+    CastFrame *frame = &cast->slots[head % CAST_QUEUE_SLOTS];
+    memcpy(frame->glyphs, glyphs, area);
+    frame->score = score;
+    frame->time = now;
+    cast->has_pending = 0;
+    store_index(&sync->head, head + 1);
+    // while the writer is busy it finds the frame on its own, no system call
+    if (is_waiting(sync)) wake(sync);
+}
+
+int cast_stop(Cast *cast) {
+    CastSync *sync = cast->sync;
+    if (!sync) return 1;
+#ifdef _WIN32
+    InterlockedExchange(&sync->stop, 1);
+    wake(sync);
+    WaitForSingleObject(sync->thread, INFINITE);
+    CloseHandle(sync->thread);
+    CloseHandle(sync->wake);
+#else
+    atomic_store_explicit(&sync->stop, 1, memory_order_release);
+    wake(sync);
+    pthread_join(sync->thread, NULL);
+    pthread_mutex_destroy(&sync->lock);
+    pthread_cond_destroy(&sync->wake);
+#endif
+    // the writer is gone and the queue is empty: the last frame, if it was dropped, is ours to write
+    if (cast->has_pending) {
+        write_frame(cast, &cast->pending);
+        cast->dropped--;
+    }
+    cast->sync = NULL;
+    int ok = !cast->failed;
+    if (fclose(cast->file)) ok = 0;
+    renderer_free(&cast->renderer);
+    arena_free(&cast->arena);
+    return ok;
+}
@@ -0,0 +1,62 @@
+#ifndef SNAKE_CAST_H
+#define SNAKE_CAST_H
+
+/* Session capture: `snake --cast <file>` records what the player sees as an
+   asciicast v2 file (a JSON header line, then one [time, "o", bytes] event
+   per frame), for asciinema or any other cast player.
+
+   The game thread never touches the file. It copies each frame's glyphs,
+   with the time it was drawn, into a bounded single-producer single-consumer
+   queue: one memcpy and one atomic store, no lock and no system call unless
+   the writer thread is asleep. The writer composes the changes since the last
+   frame it wrote with a Renderer of its own and appends the event through a
+   large stdio buffer. When the queue is full the frame is dropped rather
+   than waited for: the writer composes against what it wrote last, so the
+   next frame that gets through carries the dropped frame's changes too. Only
+   the newest dropped frame is kept, and cast_stop writes it, so the cast
+   always ends on the game's last frame. */
+
+#include <stdio.h>
+#include "render.h"
+
+#define CAST_QUEUE_SLOTS 64        // frames the writer may fall behind before frames are dropped
+#define CAST_BUFFER_SIZE (1 << 16) // stdio buffer of the cast file
+
+typedef struct {
+    char *glyphs;                // rows * cols glyphs
+    int score;                   // For the HUD
+    int64_t time;                // term_now_ns when the frame was published
+} CastFrame;
+
+typedef struct CastSync CastSync;
+
+typedef struct {
+    Arena arena;                 // Slots, the pending frame, the event buffer and the sync block
+    CastFrame slots[CAST_QUEUE_SLOTS];
+    CastFrame pending;           // Newest frame that found the queue full
+    int has_pending;
+    CastSync *sync;              // Queue indexes, the thread and its wake-up, per platform
+    FILE *file;
+    char *file_buffer;           // setvbuf buffer of the file
+    Renderer renderer;           // The writer thread's, composes the events
+    int64_t start;               // term_now_ns at cast_start, time 0 of the cast
+    char *event;                 // Writer's event line, JSON-escaped frame
+    long long published;         // Frames handed over by the game thread
+    long long dropped;           // Frames that found the queue full, folded into a later one
+    long long written;           // Frame events written, frames that changed nothing have none
+    long long bytes;             // Bytes of the file, header included
+    int failed;                  // A write failed, the writer stopped writing
+} Cast;
+
+// create `path`, write the header and start the writer for a rows x cols board; 0 with errno
+// set when the file can't be created
+int cast_start(Cast *cast, const char *path, int rows, int cols);
+
+// hand a frame's glyphs to the writer, never blocks
+void cast_publish(Cast *cast, const char *glyphs, int score);
+
+// write everything still queued and the last frame, stop the writer and close the file;
+// 0 when a write failed
+int cast_stop(Cast *cast);
+
+#endif
@@ -0,0 +1,119 @@
+#include <string.h>
+#include "env.h"
+
+static const enum layer plane_layers[ENV_PLANES] = {
+    [ENV_PLANE_WALL] = LAYER_WALL,
+    [ENV_PLANE_BODY] = LAYER_BODY,
+    [ENV_PLANE_HEAD] = LAYER_HEAD,
+    [ENV_PLANE_ENEMY] = LAYER_ENEMY,
+    [ENV_PLANE_FOOD] = LAYER_FOOD,
+};
+
+static void start_episode(SnakeEnv *env, int i) {
+    GameConfig config = env->config;
+    config.seed = env->next_seed++;
+    game_reset(&env->games[i], &config);
+    env->ticks[i] = 0;
+}
+
+void snake_env_init(SnakeEnv *env, int count, const GameConfig *config, long long max_ticks) {
+    memset(env, 0, sizeof(*env));
+    env->count = count > 0 ? count : 1;
+    env->config = *config;
+    env->next_seed = config->seed;
+    env->max_ticks = max_ticks;
+    arena_init(&env->arena, ARENA_SIZE(env->count * sizeof(GameState)) + ARENA_SIZE(env->count * sizeof(long long)));
+    env->games = ARENA_NEW(&env->arena, GameState, env->count);
+    env->ticks = ARENA_NEW(&env->arena, long long, env->count);
+    for (int i = 0; i < env->count; i++) {
+        GameConfig game_config = *config;
+        game_config.seed = env->next_seed++;
+        game_init(&env->games[i], &game_config);
+    }
+    env->rows = env->games[0].rows;
+    env->cols = env->games[0].cols;
+}
+
+void snake_env_free(SnakeEnv *env) {
+    for (int i = 0; i < env->count; i++) game_free(&env->games[i]);
+    arena_free(&env->arena);
+    env->games = NULL;
+    env->ticks = NULL;
+    env->count = 0;
+}
+
+size_t snake_env_obs_size(const SnakeEnv *env) {
+    return (size_t)ENV_PLANES * env->rows * env->cols;
+}
+
+// 8 bits as 8 bytes of 0 or 1, first bit in the first byte on little-endian hosts
+#define SPREAD(b) (((((uint64_t)(b) * 0x0101010101010101ULL) & 0x8040201008040201ULL) + \
+                    0x7F7F7F7F7F7F7F7FULL) >> 7 & 0x0101010101010101ULL)
+#define SPREAD4(b) SPREAD(b), SPREAD((b) + 1), SPREAD((b) + 2), SPREAD((b) + 3)
+#define SPREAD16(b) SPREAD4(b), SPREAD4((b) + 4), SPREAD4((b) + 8), SPREAD4((b) + 12)
+#define SPREAD64(b) SPREAD16(b), SPREAD16((b) + 16), SPREAD16((b) + 32), SPREAD16((b) + 48)
+static const uint64_t spread_table[256] = { SPREAD64(0), SPREAD64(64), SPREAD64(128), SPREAD64(192) };
+
+// one byte per cell straight from the bitboard, 8 cells per table lookup and store. A row's
+// last store may run past its end into the next row, which is written right after, so only
+// the tail of the last row needs an exact copy
+static void write_plane(const Bitboard *board, uint8_t *RESTRICT plane) {
+    // locals: the byte stores could alias the board as far as the compiler knows
+    const uint64_t *RESTRICT words = board->words;
+    int rows = board->rows, cols = board->cols, row_words = board->row_words;
+    int groups = (cols + 7) >> 3;
+    for (int row = 0; row < rows; row++, words += row_words) {
+        uint8_t *out = plane + (size_t)row * cols;
+        int stores = row + 1 < rows ? groups : cols >> 3;
+        for (int k = 0; k < stores; k++) {
+            uint64_t bytes = spread_table[(words[k >> 3] >> ((k & 7) * 8)) & 0xFF];
+            memcpy(out + 8 * k, &bytes, 8);
+        }
+        if (stores < groups) {
+            uint64_t bytes = spread_table[(words[stores >> 3] >> ((stores & 7) * 8)) & 0xFF];
+            memcpy(out + 8 * stores, &bytes, cols & 7);
+        }
+    }
+}
+
+static void write_obs(const GameState *state, uint8_t *obs) {
+    size_t plane_size = (size_t)state->rows * state->cols;
+    for (int plane = 0; plane < ENV_PLANES; plane++) {
+        write_plane(&state->layers[plane_layers[plane]], obs + plane * plane_size);
+    }
+}
+
+void snake_env_reset(SnakeEnv *env, uint8_t *obs) {
+    size_t obs_size = snake_env_obs_size(env);
+    for (int i = 0; i < env->count; i++) {
+        start_episode(env, i);
+        write_obs(&env->games[i], obs + i * obs_size);
+    }
+}
+
+void snake_env_step(SnakeEnv *env, const int *actions, uint8_t *obs, float *rewards, uint8_t *dones) {
+    static const enum direction opposite[] = { DOWN, UP, RIGHT, LEFT };
+    size_t obs_size = snake_env_obs_size(env);
+    for (int i = 0; i < env->count; i++) {
+        GameState *state = &env->games[i];
+        // like the keyboard, reversing into the neck is ignored rather than fatal
+        int action = actions[i];
+        if (action >= UP && action <= RIGHT && (state->dir == NONE || action != (int)opposite[state->dir])) {
+            state->dir = (enum direction)action;
+        }
+
+        int score = state->score;
+        compute_game_state(state);
+        env->ticks[i]++;
+        float reward = (float)(state->score - score) * ENV_REWARD_FOOD;
+        if (state->game_over) reward += ENV_REWARD_DEATH;
+        int done = state->game_over || (env->max_ticks > 0 && env->ticks[i] >= env->max_ticks);
+        if (done) {
+            env->episodes++;
+            start_episode(env, i);
+        }
+        rewards[i] = reward;
+        dones[i] = (uint8_t)done;
+        write_obs(state, obs + i * obs_size);
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef SNAKE_ENV_H
+#define SNAKE_ENV_H
+
+/* Batched environment API for training agents. One SnakeEnv steps N games in
+   lock-step: the caller passes one action per game and gets back rewards,
+   done flags and observations. An observation is ENV_PLANES uint8 planes of
+   rows * cols cells (1 where the entity is), written straight from the layer
+   bitboards into a buffer the caller owns, laid out [env][plane][row][col] so
+   it can be wrapped as a tensor without a copy. Finished games are reset
+   during the step that ended them, so the observation returned with done = 1
+   is already the first one of the next episode.
+
+   Nothing is allocated after snake_env_init. A SnakeEnv is single-threaded;
+   to use more cores, give each thread its own SnakeEnv and slice of the
+   buffers. */
+
+#include <stdint.h>
+#include "game.h"
+
+#define ENV_REWARD_FOOD 1.0f
+#define ENV_REWARD_DEATH -1.0f
+
+// observation planes, in buffer order
+enum env_plane {
+    ENV_PLANE_WALL = 0,
+    ENV_PLANE_BODY,
+    ENV_PLANE_HEAD,
+    ENV_PLANE_ENEMY,
+    ENV_PLANE_FOOD,
+    ENV_PLANES
+};
+
+typedef struct {
+    int count;                   // Games stepped together
+    int rows, cols;              // Board size of every game, walls included
+    GameConfig config;           // Config of every game, seeds aside
+    uint64_t next_seed;          // Seed of the next episode to start
+    long long max_ticks;         // Episodes are cut off (done, no penalty) after this many steps, 0 never
+    Arena arena;                 // Holds games and ticks
+    GameState *games;            // count games, each with its own arena
+    long long *ticks;            // Steps taken in each game's episode
+    long long episodes;          // Episodes finished so far
+} SnakeEnv;
+
+void snake_env_init(SnakeEnv *env, int count, const GameConfig *config, long long max_ticks);
+void snake_env_free(SnakeEnv *env);
+
+// bytes of one game's observation; the buffers passed below hold count of them
+size_t snake_env_obs_size(const SnakeEnv *env);
+
+// start a new episode in every game and write the first observations
+void snake_env_reset(SnakeEnv *env, uint8_t *obs);
+
+// actions[i] is an enum direction (UP..RIGHT) for game i, anything else keeps its course.
+// rewards and dones get one entry per game: ENV_REWARD_FOOD per food eaten,
+// ENV_REWARD_DEATH on death, done when the episode ended (and the game was reset)
+void snake_env_step(SnakeEnv *env, const int *actions, uint8_t *obs, float *rewards, uint8_t *dones);
+
+#endif
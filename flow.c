@@ -0,0 +1,254 @@
+#include <stdlib.h>
+#include <string.h>
+#include "game.h"
+#include "flow.h"
+
+// scratch flags in flow->mark
+#define MARK_INVALID 1   // lost every shortest path in this update
+#define MARK_QUEUED 2    // waiting in the seed list
+#define MARK_CHANGED 4   // listed in flow->changed
+
+size_t flow_arena_size(int width, int height) {
+    size_t size = (size_t)width * height;
+    return ARENA_SIZE(size * sizeof(int32_t)) + 3 * ARENA_SIZE(size) +
+           2 * ARENA_SIZE(size * sizeof(int)) + ARENA_SIZE(size * sizeof(int64_t));
+}
+
+void flow_init(FlowField *flow, Arena *arena, int width, int height) {
+    flow->width = width;
+    flow->height = height;
+    flow->size = width * height;
+    flow->target = -1;
+    flow->dist = arena_alloc(arena, flow->size * sizeof(int32_t));
+    flow->step = arena_alloc(arena, flow->size);
+    flow->blocked = arena_alloc(arena, flow->size);
+    // scratch comes last: it is idle (mark all 0) between updates, so game snapshots stop before it
+    flow->mark = arena_alloc(arena, flow->size);
+    flow->queue = arena_alloc(arena, flow->size * sizeof(int));
+    flow->changed = arena_alloc(arena, flow->size * sizeof(int));
+    flow->seeds = arena_alloc(arena, flow->size * sizeof(int64_t));
+    for (int i = 0; i < flow->size; i++) flow->dist[i] = FLOW_UNREACHABLE;
+    memset(flow->step, FLOW_STAY, flow->size);
+    flow->pending_count = 0;
+    flow->pending_overflow = 0;
+}
+
+void flow_set_blocked(FlowField *flow, int cell, int blocked) {
+    if (flow->blocked[cell] == blocked) return;
+    flow->blocked[cell] = (unsigned char)blocked;
+    if (flow->pending_count < FLOW_PENDING_MAX) flow->pending[flow->pending_count++] = cell;
+    else flow->pending_overflow = 1;
+}
+
+// the four neighbours of a cell on the torus, indexed by enum direction
+static inline void neighbors(const FlowField *flow, int cell, int out[4]) {
+    int x = cell % flow->width;
+    int row = cell - x;
+    out[UP] = row == 0 ? cell + flow->size - flow->width : cell - flow->width;
+    out[DOWN] = row == flow->size - flow->width ? x : cell + flow->width;
+    out[LEFT] = x == 0 ? row + flow->width - 1 : cell - 1;
+    out[RIGHT] = x == flow->width - 1 ? row : cell + 1;
+}
+
+// first neighbour one step closer to the target, in enum direction order
+static unsigned char best_step(const FlowField *flow, int cell) {
+    int32_t d = flow->dist[cell];
+    if (d == 0 || d == FLOW_UNREACHABLE) return FLOW_STAY;
+    int n[4];
+    neighbors(flow, cell, n);
+    for (int k = 0; k < 4; k++) {
+        if (!flow->blocked[n[k]] && flow->dist[n[k]] == d - 1) return (unsigned char)k;
+    }
+    return FLOW_STAY;
+}
+
+void flow_rebuild(FlowField *flow, int target) {
+    int32_t *dist = flow->dist;
+    int *queue = flow->queue;
+
+    flow->target = target;
+    flow->pending_count = 0;
+    flow->pending_overflow = 0;
+    for (int i = 0; i < flow->size; i++) dist[i] = FLOW_UNREACHABLE;
+
+    if (target >= 0) {
+        int head = 0, tail = 0;
+        dist[target] = 0;
+        queue[tail++] = target;
+        while (head < tail) {
+            int u = queue[head++];
+            int32_t d = dist[u] + 1;
+            int n[4];
+            neighbors(flow, u, n);
+            for (int k = 0; k < 4; k++) {
+                int v = n[k];
+                if (!flow->blocked[v] && dist[v] == FLOW_UNREACHABLE) {
+                    dist[v] = d;
+                    queue[tail++] = v;
+                }
+            }
+        }
+    }
+    // same choice as best_step, with the neighbours walked row by row instead of divided out
+    for (int y = 0; y < flow->height; y++) {
+        int row = y * flow->width;
+        int up = y == 0 ? flow->size - flow->width : -flow->width;
+        int down = y == flow->height - 1 ? -row : flow->width;
+        for (int x = 0; x < flow->width; x++) {
+            int cell = row + x;
+            int32_t d = dist[cell] - 1;
+            unsigned char step = FLOW_STAY;
+            if (d >= 0 && d != FLOW_UNREACHABLE - 1) {
+                int n[4] = {
+                    cell + up,
+                    cell + down,
+                    x == 0 ? cell + flow->width - 1 : cell - 1,
+                    x == flow->width - 1 ? row : cell + 1,
+                };
+                for (int k = 0; k < 4; k++) {
+                    if (!flow->blocked[n[k]] && dist[n[k]] == d) {
+                        step = (unsigned char)k;
+                        break;
+                    }
+                }
+            }
+            flow->step[cell] = step;
+        }
+    }
+}
+
+// still has a neighbour on a valid shortest path to the target
+static int is_supported(const FlowField *flow, int cell) {
+    int n[4];
+    neighbors(flow, cell, n);
+    for (int k = 0; k < 4; k++) {
+        int w = n[k];
+        if (!flow->blocked[w] && !(flow->mark[w] & MARK_INVALID) && flow->dist[w] == flow->dist[cell] - 1) return 1;
+    }
+    return 0;
+}
+
+static void note_changed(FlowField *flow, int cell, int *changed_count) {
+    if (flow->mark[cell] & MARK_CHANGED) return;
+    flow->mark[cell] |= MARK_CHANGED;
+    flow->changed[(*changed_count)++] = cell;
+}
+
+static int compare_seeds(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// shortest distance a cell can get from its neighbours right now
+static int32_t distance_from_neighbors(const FlowField *flow, int cell) {
+    int32_t best = FLOW_UNREACHABLE;
+    int n[4];
+    neighbors(flow, cell, n);
+    for (int k = 0; k < 4; k++) {
+        int w = n[k];
+        if (!flow->blocked[w] && flow->dist[w] < best) best = flow->dist[w];
+    }
+    return best == FLOW_UNREACHABLE ? best : best + 1;
+}
+
+/* Incremental update in three passes:
+   1. every cell whose shortest paths all went through a newly blocked cell is
+      invalidated (a cell is re-examined each time one of its parents is, so
+      the order in which seeds are processed does not matter);
+   2. invalidated and newly freed cells take the best distance offered by their
+      neighbours and the improvement grows outwards like a BFS;
+   3. steps are recomputed only around cells whose distance changed. */
+void flow_update(FlowField *flow) {
+    if (flow->target < 0) return;
+    if (flow->pending_overflow) {
+        flow_rebuild(flow, flow->target);
+        return;
+    }
+    if (flow->pending_count == 0) return;
+
+    int32_t *dist = flow->dist;
+    unsigned char *mark = flow->mark;
+    int *queue = flow->queue;
+    int changed_count = 0;
+    int n[4];
+
+    // 1. invalidate
+    int invalid = 0;
+    for (int i = 0; i < flow->pending_count; i++) {
+        int p = flow->pending[i];
+        if (flow->blocked[p] && p != flow->target && dist[p] != FLOW_UNREACHABLE && !(mark[p] & MARK_INVALID)) {
+            mark[p] |= MARK_INVALID;
+            queue[invalid++] = p;
+        }
+    }
+    for (int head = 0; head < invalid; head++) {
+        int u = queue[head];
+        neighbors(flow, u, n);
+        for (int k = 0; k < 4; k++) {
+            int v = n[k];
+            if ((mark[v] & MARK_INVALID) || flow->blocked[v] || dist[v] != dist[u] + 1) continue;
+            if (!is_supported(flow, v)) {
+                mark[v] |= MARK_INVALID;
+                queue[invalid++] = v;
+            }
+        }
+    }
+    for (int i = 0; i < invalid; i++) {
+        int c = queue[i];
+        dist[c] = FLOW_UNREACHABLE;
+        mark[c] &= ~MARK_INVALID;
+        note_changed(flow, c, &changed_count);
+    }
+
+    // 2. reseed from the surviving neighbours, then grow outwards in distance
+    // order: seeds sorted by distance merged with a FIFO queue, so every cell is
+    // settled once with its final distance
+    int seed_count = 0;
+    int invalidated = changed_count;
+    for (int i = 0; i < invalidated + flow->pending_count; i++) {
+        int c = i < invalidated ? flow->changed[i] : flow->pending[i - invalidated];
+        if (flow->blocked[c] || (mark[c] & MARK_QUEUED)) continue;
+        int32_t d = distance_from_neighbors(flow, c);
+        if (d < dist[c]) {
+            dist[c] = d;
+            note_changed(flow, c, &changed_count);
+            mark[c] |= MARK_QUEUED;
+            flow->seeds[seed_count++] = ((int64_t)d << 32) | (uint32_t)c;
+        }
+    }
+    qsort(flow->seeds, seed_count, sizeof(int64_t), compare_seeds);
+
+    int head = 0, tail = 0, next_seed = 0;
+    while (head < tail || next_seed < seed_count) {
+        int u;
+        if (next_seed < seed_count && (head == tail || (flow->seeds[next_seed] >> 32) <= dist[queue[head]])) {
+            u = (int)(uint32_t)flow->seeds[next_seed++];
+            // a neighbour already reached it with a shorter distance
+            if (!(mark[u] & MARK_QUEUED)) continue;
+        } else {
+            u = queue[head++];
+        }
+        mark[u] &= ~MARK_QUEUED;
+        int32_t d = dist[u] + 1;
+        neighbors(flow, u, n);
+        for (int k = 0; k < 4; k++) {
+            int v = n[k];
+            if (flow->blocked[v] || d >= dist[v]) continue;
+            dist[v] = d;
+            note_changed(flow, v, &changed_count);
+            // settled through the queue from now on, a pending seed entry becomes stale
+            mark[v] &= ~MARK_QUEUED;
+            queue[tail++] = v;
+        }
+    }
+
+    // 3. steps around the cells that changed
+    for (int i = 0; i < changed_count; i++) {
+        int c = flow->changed[i];
+        flow->step[c] = best_step(flow, c);
+        neighbors(flow, c, n);
+        for (int k = 0; k < 4; k++) flow->step[n[k]] = best_step(flow, n[k]);
+    }
+    for (int i = 0; i < changed_count; i++) mark[flow->changed[i]] = 0;
+    flow->pending_count = 0;
+}
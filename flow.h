@@ -0,0 +1,48 @@
+#ifndef SNAKE_FLOW_H
+#define SNAKE_FLOW_H
+
+/* Shared BFS flow field over a wrap-around (torus) grid.
+   The field is built once from the target and every chaser then moves with a
+   single lookup of step[cell]. When only a few cells change between ticks
+   (the snake's head and tail), flow_update patches the distances around them
+   instead of running the whole BFS again. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+
+#define FLOW_UNREACHABLE INT32_MAX
+#define FLOW_STAY 4                // step value of cells that should not move
+#define FLOW_PENDING_MAX 256       // block changes buffered before falling back to a rebuild
+
+typedef struct {
+    int width, height;           // Torus dimensions
+    int size;                    // width * height
+    int target;                  // Cell the field leads to, -1 before the first build
+    int32_t *dist;               // Steps to the target, FLOW_UNREACHABLE when cut off or blocked
+    unsigned char *step;         // enum direction to take from each cell, FLOW_STAY to stay
+    unsigned char *blocked;      // 1 for cells chasers cannot enter
+    unsigned char *mark;         // Scratch flags for incremental updates
+    int *queue;                  // BFS ring queue
+    int *changed;                // Cells whose distance changed in the current update
+    int64_t *seeds;              // (distance << 32 | cell) of the cells an update regrows from
+    int pending[FLOW_PENDING_MAX]; // Cells whose blocked flag changed since the last update
+    int pending_count;
+    int pending_overflow;        // Too many changes, the next update rebuilds
+} FlowField;
+
+// bytes flow_init takes from an arena
+size_t flow_arena_size(int width, int height);
+// the field's arrays live in `arena` and go away with it
+void flow_init(FlowField *flow, Arena *arena, int width, int height);
+
+// mark a cell as blocked or free, applied at the next flow_update
+void flow_set_blocked(FlowField *flow, int cell, int blocked);
+
+// full BFS from target
+void flow_rebuild(FlowField *flow, int target);
+
+// patch the field for the cells changed since the last build or update
+void flow_update(FlowField *flow);
+
+#endif
@@ -0,0 +1,578 @@
+#include <stdlib.h>
+#include <string.h>
+#include "game.h"
+
+/* Allocator */
+static GameAllocator game_allocator = { malloc, free };
+
+void game_set_allocator(const GameAllocator *allocator) {
+    game_allocator = *allocator;
+}
+
+void *game_alloc(size_t size) {
+    void *ptr = game_allocator.alloc(size);
+    if (!ptr) die("malloc");
+    return ptr;
+}
+
+void game_release(void *ptr) {
+    if (ptr) game_allocator.release(ptr);
+}
+
+/* Random numbers */
+void rng_seed(Rng *rng, uint64_t seed) {
+    // splitmix64 scramble so that nearby seeds give unrelated streams
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    rng->state = z ? z : 0x9E3779B97F4A7C15ULL; // xorshift must never be seeded with 0
+}
+
+uint32_t rng_next(Rng *rng) {
+    uint64_t x = rng->state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    rng->state = x;
+    return (uint32_t)((x * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+int rng_range(Rng *rng, int n) {
+    // multiply-shift instead of modulo: no division and no modulo bias worth caring about
+    return (int)(((uint64_t)rng_next(rng) * (uint32_t)n) >> 32);
+}
+
+/* Grid API */
+/* convert coordinates to index
+NOTE: this function has a wrap-around logic that is not
+utilised for the snake because hitting the walls cause death */
+int coordinates_to_index(const GameState *state, int row, int col) {
+    // power-of-two boards wrap with a mask, whatever the distance
+    if (state->grid_pow2) return (col & (state->cols - 1)) + state->cols * (row & (state->rows - 1));
+	if (row < 0) row = row + state->rows;
+	if (col < 0) col = col + state->cols;
+	if (row >= state->rows) row = row % state->rows;
+	if (col >= state->cols) col = col % state->cols;
+	return col+state->cols*row;
+}
+
+/* Layers */
+// index of an interior cell in the enemies' flow field
+static inline int playable_index(int playable_cols, int row, int col) {
+    return (row - 1) * playable_cols + (col - 1);
+}
+
+// wrap a coordinate that stepped onto the border back into the playable area
+static inline int wrap_playable(int v, int size) {
+    return v == 0 ? size - 2 : (v == size - 1 ? 1 : v);
+}
+
+// same when the playable size (size - 2) is a power of two: v - 1 modulo it, with a mask
+static inline int wrap_playable_pow2(int v, int size) {
+    return ((v - 1) & (size - 3)) + 1;
+}
+
+// occupancy only: callers keep row and col on the board, no wrap-around here
+void cell_set(GameState *state, enum layer layer, int row, int col) {
+    // only the body blocks enemies, and it never touches the walls
+    if (layer == LAYER_BODY && !board_test(&state->layers[LAYER_BODY], row, col)) {
+        flow_set_blocked(&state->flow, playable_index(state->cols - 2, row, col), 1);
+    }
+    board_set(&state->layers[layer], row, col);
+}
+
+void cell_clear(GameState *state, enum layer layer, int row, int col) {
+    if (layer == LAYER_BODY && board_test(&state->layers[LAYER_BODY], row, col)) {
+        flow_set_blocked(&state->flow, playable_index(state->cols - 2, row, col), 0);
+    }
+    board_clear(&state->layers[layer], row, col);
+}
+
+int cell_test(const GameState *state, enum layer layer, int row, int col) {
+    return board_test(&state->layers[layer], row, col);
+}
+
+static const char layer_glyph[LAYER_COUNT] = {
+    WALL_CHAR, FOOD_CHAR, SNAKE_BODY_CHAR, SNAKE_HEAD_CHAR, ENEMY_CHAR
+};
+
+// glyph of a cell, derived from the layers; only the renderer and tools need it
+char get_cell_state(const GameState *state, int row, int col) {
+    int index = coordinates_to_index(state, row, col);
+    if (index >= 0 && index < state->rows * state->cols) {
+        row = index / state->cols;
+        col = index % state->cols;
+        for (int layer = LAYER_COUNT - 1; layer >= 0; layer--) {
+            if (board_test(&state->layers[layer], row, col)) return layer_glyph[layer];
+        }
+    }
+    return EMPTY_CHAR;
+}
+
+// paint every layer's set bits over an empty board, bottom layer first
+void game_render_glyphs(const GameState *state, char *glyphs) {
+    memset(glyphs, EMPTY_CHAR, (size_t)state->rows * state->cols);
+    for (int layer = 0; layer < LAYER_COUNT; layer++) {
+        const Bitboard *board = &state->layers[layer];
+        char glyph = layer_glyph[layer];
+        for (int w = 0; w < board->size; w++) {
+            uint64_t bits = board->words[w];
+            if (!bits) continue;
+            char *row = glyphs + (w / board->row_words) * state->cols + (w % board->row_words) * 64;
+            // full words (the top and bottom walls) in one go
+            if (bits == ~0ULL) {
+                memset(row, glyph, 64);
+                continue;
+            }
+            while (bits) {
+                row[ctz64(bits)] = glyph;
+                bits &= bits - 1;
+            }
+        }
+    }
+}
+
+int game_count_free(const GameState *state) {
+    return board_count_free(state->layers, LAYER_COUNT);
+}
+
+int game_nth_free(const GameState *state, int n) {
+    return board_nth_free(state->layers, LAYER_COUNT, n);
+}
+
+int game_random_free(GameState *state) {
+    int count = game_count_free(state);
+    if (count == 0) return -1;
+    return game_nth_free(state, rng_range(&state->rng, count));
+}
+
+/* Snake body API */
+// the head segment
+SnakeSegment *snake_head(SnakeBody *body) {
+    return &body->segments[body->head];
+}
+
+// the last segment, `length - 1` slots after the head (wrapping around the ring)
+SnakeSegment *snake_tail(SnakeBody *body) {
+    int index = body->head + body->length - 1;
+    if (index >= body->capacity) index -= body->capacity;
+    return &body->segments[index];
+}
+
+// the head moves one slot backwards so the rest of the body stays where it is
+void snake_push_head(SnakeBody *body, int x, int y) {
+    body->head = body->head == 0 ? body->capacity - 1 : body->head - 1;
+    body->segments[body->head].x = x;
+    body->segments[body->head].y = y;
+    body->length++;
+}
+
+void snake_pop_tail(SnakeBody *body) {
+    if (body->length > 0) body->length--;
+}
+
+// place food in a random empty cell, or nowhere when the board is full
+void place_food(GameState *state) {
+    int index = game_random_free(state);
+    if (index < 0) {
+        state->food_x = -1;
+        state->food_y = -1;
+        return;
+    }
+    state->food_x = index % state->cols;
+    state->food_y = index / state->cols;
+    cell_set(state, LAYER_FOOD, state->food_y, state->food_x);
+}
+
+/* Enemy pool */
+// add an enemy at (x, y), returns its slot or -1 when the pool is full.
+// cells may hold more than one enemy, the layer only records that one is there
+int spawn_enemy(GameState *state, int x, int y) {
+    EnemyPool *pool = &state->enemies;
+    if (pool->count >= pool->capacity) return -1;
+    int slot = pool->count++;
+    pool->x[slot] = x;
+    pool->y[slot] = y;
+    pool->state[slot] = ENEMY_ACTIVE;
+    cell_set(state, LAYER_ENEMY, y, x);
+    return slot;
+}
+
+// place a new enemy in a random empty cell every time the score changes
+void place_enemy(GameState *state) {
+    if (state->enemies.count >= state->enemies.capacity) return;
+    int index = game_random_free(state);
+    if (index < 0) return; // board is full
+
+    // avoid spawning right in front of the snake: redraw a few times if the cell
+    // is within 5 cells of the head on the same row or column
+    SnakeSegment *head = snake_head(&state->snake);
+    for (int attempt = 0; attempt < ENEMY_SPAWN_ATTEMPTS; attempt++) {
+        int x = index % state->cols;
+        int y = index / state->cols;
+        int near_row = y == head->y && abs(x - head->x) <= 5;
+        int near_col = x == head->x && abs(y - head->y) <= 5;
+        if (!near_row && !near_col) break;
+        index = game_random_free(state);
+    }
+    spawn_enemy(state, index % state->cols, index / state->cols);
+}
+
+// initialize the snake at the center of the grid
+static void init_snake(GameState *state) {
+    state->snake.head = 0;
+    state->snake.length = 0;
+    snake_push_head(&state->snake, state->cols / 2, state->rows / 2);
+
+    SnakeSegment *head = snake_head(&state->snake);
+    cell_set(state, LAYER_HEAD, head->y, head->x);
+}
+
+// initialize the grid with walls and empty spaces
+static void init_grid(GameState *state) {
+    for (int i = 0; i < state->rows; i++) {
+        for (int j = 0; j < state->cols; j++) {
+            if (i == 0 || i == state->rows - 1 || j == 0 || j == state->cols - 1) {
+                cell_set(state, LAYER_WALL, i, j);
+            }
+        }
+    }
+}
+
+void game_config_default(GameConfig *config) {
+    config->rows = DEFAULT_GRID_ROWS;
+    config->cols = DEFAULT_GRID_COLS;
+    config->seed = 1;
+    config->speed = DEFAULT_SPEED;
+    config->max_enemies = DEFAULT_MAX_ENEMIES;
+}
+
+static int is_pow2(int v) {
+    return v > 0 && (v & (v - 1)) == 0;
+}
+
+// bytes of every array a game of this configuration needs
+static size_t game_arena_size(int rows, int cols, int capacity) {
+    int area = rows * cols;
+    int slots = capacity > 0 ? capacity : 1;
+    return LAYER_COUNT * board_arena_size(rows, cols) +
+           ARENA_SIZE((size_t)area * sizeof(SnakeSegment)) +
+           4 * ARENA_SIZE((size_t)slots * sizeof(int)) + ARENA_SIZE(slots) +
+           flow_arena_size(cols - 2, rows - 2);
+}
+
+// initialize the game state
+void game_init(GameState *state, const GameConfig *config) {
+    memset(&state->arena, 0, sizeof(state->arena));
+    state->stats = NULL;
+    game_reset(state, config);
+}
+
+// start a new game, reusing the arena of the previous one when it is big enough
+void game_reset(GameState *state, const GameConfig *config) {
+    rng_seed(&state->rng, config->seed);
+
+    state->rows = config->rows < MIN_GRID_ROWS ? MIN_GRID_ROWS : config->rows;
+    state->cols = config->cols < MIN_GRID_COLS ? MIN_GRID_COLS : config->cols;
+    state->grid_pow2 = is_pow2(state->rows) && is_pow2(state->cols);
+    state->playable_pow2 = is_pow2(state->rows - 2) && is_pow2(state->cols - 2);
+    int area = state->rows * state->cols;
+
+    // every array the game uses comes out of one block sized here, scoring never allocates
+    int capacity = config->max_enemies > 0 ? config->max_enemies : 0;
+    int slots = capacity > 0 ? capacity : 1;
+    size_t size = game_arena_size(state->rows, state->cols, capacity);
+    if (state->arena.block && size <= state->arena.size) {
+        arena_reset(&state->arena);
+    } else {
+        if (state->arena.block) arena_free(&state->arena);
+        arena_init(&state->arena, size);
+    }
+    Arena *arena = &state->arena;
+
+    for (int layer = 0; layer < LAYER_COUNT; layer++) {
+        board_init(&state->layers[layer], arena, state->rows, state->cols);
+    }
+    state->snake.segments = ARENA_NEW(arena, SnakeSegment, area);
+    state->snake.capacity = area;
+
+    EnemyPool *pool = &state->enemies;
+    pool->x = ARENA_NEW(arena, int, slots);
+    pool->y = ARENA_NEW(arena, int, slots);
+    pool->next_x = ARENA_NEW(arena, int, slots);
+    pool->next_y = ARENA_NEW(arena, int, slots);
+    pool->state = ARENA_NEW(arena, unsigned char, slots);
+    pool->count = 0;
+    pool->capacity = capacity;
+    flow_init(&state->flow, arena, state->cols - 2, state->rows - 2);
+    state->snapshot_bytes = (size_t)((unsigned char *)state->flow.mark - arena->base);
+
+    // draw board
+    init_grid(state);
+
+    // init the game state
+    state->snake.head = 0;
+    state->snake.length = 0;
+    state->food_x = -1;
+    state->food_y = -1;
+    state->score = 0;
+    state->dir = NONE; // no initial direction
+    state->game_over = 0;
+    state->speed = config->speed;
+    state->enemy_move_counter = 0;
+
+    init_snake(state);
+    place_food(state);
+}
+
+void game_free(GameState *state) {
+    // layers, snake, enemies and flow field all live in the arena
+    arena_free(&state->arena);
+    memset(&state->enemies, 0, sizeof(state->enemies));
+    memset(&state->snake, 0, sizeof(state->snake));
+    memset(&state->flow, 0, sizeof(state->flow));
+}
+
+void game_copy(GameState *state, const GameState *from) {
+    if (state == from) return;
+    Arena arena = state->arena;
+    Stats *stats = state->stats;
+    FlowField scratch = state->flow;
+    if (from->snapshot_bytes > arena.size) die("game_copy");
+    memcpy(arena.base, from->arena.base, from->snapshot_bytes);
+
+    *state = *from;
+    state->arena = arena;
+    state->stats = stats;
+    state->flow.mark = scratch.mark;
+    state->flow.queue = scratch.queue;
+    state->flow.changed = scratch.changed;
+    state->flow.seeds = scratch.seeds;
+
+    // every other array lives in the prefix, so each pointer moves to the same offset in ours
+    const unsigned char *old = from->arena.base;
+#define REBASE(ptr) ((ptr) = (void *)(arena.base + ((const unsigned char *)(ptr) - old)))
+    for (int layer = 0; layer < LAYER_COUNT; layer++) REBASE(state->layers[layer].words);
+    REBASE(state->snake.segments);
+    REBASE(state->enemies.x);
+    REBASE(state->enemies.y);
+    REBASE(state->enemies.next_x);
+    REBASE(state->enemies.next_y);
+    REBASE(state->enemies.state);
+    REBASE(state->flow.dist);
+    REBASE(state->flow.step);
+    REBASE(state->flow.blocked);
+#undef REBASE
+}
+
+/* Batched movement kernel: every enemy looks up the flow field step of its
+   cell. Only a gather and arithmetic on the pool arrays, no branches on the
+   grid and no early exits, so the compiler can vectorize the loop. `pow2` is
+   a constant in each caller below, so the wrap compiles to either the border
+   checks or a mask and the loop carries no test for it. */
+static inline void plan_enemy_moves(int count, const int *RESTRICT x, const int *RESTRICT y,
+                                    const unsigned char *RESTRICT step,
+                                    int *RESTRICT next_x, int *RESTRICT next_y,
+                                    int rows, int cols, const int pow2) {
+    // indexed by enum direction, FLOW_STAY last
+    static const int step_dx[] = { 0, 0, -1, 1, 0 };
+    static const int step_dy[] = { -1, 1, 0, 0, 0 };
+
+    for (int i = 0; i < count; i++) {
+        int s = step[playable_index(cols - 2, y[i], x[i])];
+        if (pow2) {
+            next_x[i] = wrap_playable_pow2(x[i] + step_dx[s], cols);
+            next_y[i] = wrap_playable_pow2(y[i] + step_dy[s], rows);
+        } else {
+            next_x[i] = wrap_playable(x[i] + step_dx[s], cols);
+            next_y[i] = wrap_playable(y[i] + step_dy[s], rows);
+        }
+    }
+}
+
+static void plan_enemy_moves_generic(GameState *state) {
+    EnemyPool *pool = &state->enemies;
+    plan_enemy_moves(pool->count, pool->x, pool->y, state->flow.step, pool->next_x, pool->next_y,
+                     state->rows, state->cols, 0);
+}
+
+static void plan_enemy_moves_pow2(GameState *state) {
+    EnemyPool *pool = &state->enemies;
+    plan_enemy_moves(pool->count, pool->x, pool->y, state->flow.step, pool->next_x, pool->next_y,
+                     state->rows, state->cols, 1);
+}
+
+// move every enemy one step along the shortest path to the food (or the snake when there is no food)
+void compute_enemy_position(GameState *state) {
+    EnemyPool *pool = &state->enemies;
+    if (pool->count == 0 || state->snake.length == 0) {
+        return;
+    }
+
+    // target: food coordinates, or the snake itself once the board is full
+    SnakeSegment *head = snake_head(&state->snake);
+    int target_x = state->food_x;
+    int target_y = state->food_y;
+    if (target_x < 0) {
+        target_x = head->x;
+        target_y = head->y;
+    }
+
+    // one field for the whole pool: rebuilt when the target moves, patched otherwise
+    int target = playable_index(state->cols - 2, target_y, target_x);
+    if (target != state->flow.target) flow_rebuild(&state->flow, target);
+    else flow_update(&state->flow);
+
+    if (state->playable_pow2) plan_enemy_moves_pow2(state);
+    else plan_enemy_moves_generic(state);
+
+    // every enemy moves, so the layer is rebuilt from scratch
+    Bitboard *enemies = &state->layers[LAYER_ENEMY];
+    memset(enemies->words, 0, (size_t)enemies->size * sizeof(uint64_t));
+
+    int eaten = 0;
+    for (int i = 0; i < pool->count; i++) {
+        int next_x = pool->next_x[i];
+        int next_y = pool->next_y[i];
+
+        // check if enemy reached the food
+        if (next_x == state->food_x && next_y == state->food_y) {
+            cell_clear(state, LAYER_FOOD, next_y, next_x);
+            eaten = 1;
+        }
+
+        // game over condition is collision with snake head
+        if (next_x == head->x && next_y == head->y) {
+            state->game_over = 1;
+        }
+
+        // update enemy coordinates and draw it at its new position
+        pool->x[i] = next_x;
+        pool->y[i] = next_y;
+        cell_set(state, LAYER_ENEMY, next_y, next_x);
+    }
+    // enemy 'eats' the food: reposition it once the layer holds every enemy again, or it
+    // could land under one that hadn't moved yet
+    if (eaten) place_food(state);
+}
+
+// compute the new position of the snake based on its direction
+void compute_snake_position(GameState *state) {
+    // waiting for the first input
+    if (state->dir == NONE) {
+        return;
+    }
+    SnakeSegment *head = snake_head(&state->snake);
+
+    // new head position based on current direction
+    int new_x = head->x;
+    int new_y = head->y;
+    switch (state->dir) {
+        case UP:    new_y--; break;
+        case DOWN:  new_y++; break;
+        case LEFT:  new_x--; break;
+        case RIGHT: new_x++; break;
+        default: break;
+    }
+
+    // handle physical wrap-around
+    // if snake hits a wall, it appears on the opposite side
+    if (state->score >= LEVEL_UPGRADE_SCORE) { // if score is high enough, allow wrap-around
+        if (state->playable_pow2) {
+            new_x = wrap_playable_pow2(new_x, state->cols);
+            new_y = wrap_playable_pow2(new_y, state->rows);
+        } else {
+            new_x = wrap_playable(new_x, state->cols);
+            new_y = wrap_playable(new_y, state->rows);
+        }
+    }
+
+    // check for collisions, one bit test per layer: the new head is always on the board
+    // if score < 20 we don't allow the snake to go through walls
+    if (cell_test(state, LAYER_WALL, new_y, new_x) && state->score < LEVEL_UPGRADE_SCORE) {
+        state->game_over = 1;
+        return;
+    }
+    if (cell_test(state, LAYER_BODY, new_y, new_x) || cell_test(state, LAYER_ENEMY, new_y, new_x)) {
+        state->game_over = 1;
+        return;
+    }
+
+    // the old head becomes body, then the new head is pushed in front of it
+    cell_clear(state, LAYER_HEAD, head->y, head->x);
+    cell_set(state, LAYER_BODY, head->y, head->x);
+    snake_push_head(&state->snake, new_x, new_y);
+    cell_set(state, LAYER_HEAD, new_y, new_x);
+
+    // check if the snake has eaten
+    if (new_x == state->food_x && new_y == state->food_y) {
+        state->score++;
+        cell_clear(state, LAYER_FOOD, new_y, new_x);
+        place_food(state); // snake grows (we don't remove the tail)
+        // place an enemy
+        if (state->score % 1 == 0) { // adding anemies and increasing speed every 1 point (seems more for fun)
+            place_enemy(state);
+            if (state->speed > 0) state->speed--;
+            //g_level++;
+        }
+    } else {
+        // if it hasn't eaten, remove the tail segment from the screen buffer
+        SnakeSegment *tail = snake_tail(&state->snake);
+        cell_clear(state, LAYER_BODY, tail->y, tail->x);
+        snake_pop_tail(&state->snake);
+    }
+}
+
+void compute_game_state(GameState *state) {
+    // snake move always
+    int64_t start = stats_begin(state->stats);
+    compute_snake_position(state);
+    stats_end(state->stats, PHASE_SNAKE, start);
+    if (state->game_over) return;
+
+    // enemies move only if the counter reaches the interval
+    if (state->enemies.count > 0) {
+        state->enemy_move_counter++;
+
+        if (state->enemy_move_counter >= ENEMY_MOVE_INTERVAL) {
+            start = stats_begin(state->stats);
+            compute_enemy_position(state);
+            stats_end(state->stats, PHASE_ENEMIES, start);
+            state->enemy_move_counter = 0;
+        }
+    }
+    
+    if (state->game_over) return;
+}
+
+/* Checksum */
+static inline uint64_t checksum_mix(uint64_t hash, uint64_t value) {
+    // FNV-1a over 64-bit words, plenty to tell two diverged games apart
+    return (hash ^ value) * 0x100000001B3ULL;
+}
+
+uint64_t game_checksum(const GameState *state) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    hash = checksum_mix(hash, (uint64_t)state->rows << 32 | (uint32_t)state->cols);
+    for (int layer = 0; layer < LAYER_COUNT; layer++) {
+        const Bitboard *board = &state->layers[layer];
+        for (int i = 0; i < board->size; i++) hash = checksum_mix(hash, board->words[i]);
+    }
+    // the body from head to tail, wherever the ring happens to start
+    const SnakeBody *body = &state->snake;
+    for (int i = 0; i < body->length; i++) {
+        const SnakeSegment *segment = &body->segments[(body->head + i) % body->capacity];
+        hash = checksum_mix(hash, (uint64_t)(uint32_t)segment->x << 32 | (uint32_t)segment->y);
+    }
+    const EnemyPool *pool = &state->enemies;
+    for (int i = 0; i < pool->count; i++) {
+        hash = checksum_mix(hash, (uint64_t)(uint32_t)pool->x[i] << 32 | (uint32_t)pool->y[i]);
+        hash = checksum_mix(hash, pool->state[i]);
+    }
+    hash = checksum_mix(hash, (uint64_t)(uint32_t)state->food_x << 32 | (uint32_t)state->food_y);
+    hash = checksum_mix(hash, (uint64_t)(uint32_t)state->score << 32 | (uint32_t)state->dir);
+    hash = checksum_mix(hash, (uint64_t)(uint32_t)state->speed << 32 | (uint32_t)state->enemy_move_counter);
+    hash = checksum_mix(hash, (uint64_t)state->game_over);
+    return checksum_mix(hash, state->rng.state);
+}
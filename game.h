@@ -0,0 +1,177 @@
+#ifndef SNAKE_GAME_H
+#define SNAKE_GAME_H
+
+/* Platform-free simulation core: no console, no sleeping, no globals.
+   Everything the game needs lives in GameState, randomness comes from the Rng
+   stored in it, so the same seed and inputs always produce the same game. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+#include "bitboard.h"
+#include "flow.h"
+#include "stats.h"
+
+// the board is sized at startup, walls included; enemies live on the torus inside the walls
+#define DEFAULT_GRID_ROWS 27
+#define DEFAULT_GRID_COLS 120
+#define MIN_GRID_ROWS 8
+#define MIN_GRID_COLS 16
+
+#define SNAKE_HEAD_CHAR '0'
+#define SNAKE_BODY_CHAR 'o'
+#define ENEMY_CHAR '*'
+#define FOOD_CHAR '$'
+#define EMPTY_CHAR ' '
+#define WALL_CHAR '`'
+#define RIVAL_HEAD_CHAR '@' // the AI snakes of swarm.c
+#define RIVAL_BODY_CHAR '+'
+
+#define LEVEL_UPGRADE_SCORE 5 // score to unlock new power (wrap-around)
+
+#define ENEMY_MOVE_INTERVAL 2
+#define ENEMY_SPAWN_ATTEMPTS 4 // redraws when an enemy would spawn in front of the snake
+
+#define DEFAULT_SPEED 60 // ms
+#define DEFAULT_MAX_ENEMIES 16 // enemy pool capacity, one enemy joins per point scored
+
+#ifdef _MSC_VER
+#define RESTRICT __restrict
+#else
+#define RESTRICT restrict
+#endif
+
+enum direction {
+    NONE = -1, // waiting for the first input
+    UP = 0,
+    DOWN,
+    LEFT,
+    RIGHT
+};
+
+/* Data structures */
+typedef struct {
+    uint64_t state;              // xorshift64* state, never 0
+} Rng;
+
+typedef struct {
+    int x, y;                    // Position of the segment
+} SnakeSegment;
+
+// the body is a circular buffer: pushing the head and popping the tail are O(1)
+// and never allocate. segments[head] is the head, the tail is `length - 1` slots after it
+typedef struct {
+    SnakeSegment *segments;      // Ring storage, one slot per grid cell
+    int capacity;                // Number of slots
+    int head;                    // Index of the head segment
+    int length;                  // Number of segments
+} SnakeBody;
+
+// one bitboard per kind of entity, in the order glyphs are painted (later layers win)
+enum layer {
+    LAYER_WALL = 0,
+    LAYER_FOOD,
+    LAYER_BODY,
+    LAYER_HEAD,
+    LAYER_ENEMY,
+    LAYER_COUNT
+};
+
+enum enemy_state {
+    ENEMY_FREE = 0,
+    ENEMY_ACTIVE
+};
+
+// enemies stored as parallel arrays so the movement kernel runs over the whole pool at once
+typedef struct {
+    int *x, *y;                  // Positions
+    int *next_x, *next_y;        // Planned step toward the target
+    unsigned char *state;        // enum enemy_state of each slot
+    int count;                   // Slots in use
+    int capacity;                // Maximum number of enemies
+} EnemyPool;
+
+typedef struct {
+    int rows, cols;            // Board size, walls included
+    int grid_pow2;             // rows and cols are powers of two: wrapping is a mask
+    int playable_pow2;         // same for the area inside the walls
+    Arena arena;               // Every array below, reserved once by game_init
+    size_t snapshot_bytes;     // Arena prefix game_copy copies, the flow field's scratch follows it
+    Bitboard layers[LAYER_COUNT]; // Occupancy of each enum layer, a cell is free when no layer has it
+    SnakeBody snake;           // Body of the snake, head first
+    EnemyPool enemies;         // Every enemy on the board
+    FlowField flow;            // Shortest paths to the enemies' target, the body blocks them
+    int food_x, food_y;        // Position of the food
+    int score;                 // Player's score
+    enum direction dir;        // Direction of the snake
+    int game_over;             // Game over flag
+    int speed;                 // Tick period in ms, shrinks as the score grows
+    int enemy_move_counter;    // Counter for enemy movement
+    Rng rng;                   // Source of all randomness in the game
+    Stats *stats;              // Phase timers, NULL when disabled; kept across game_reset
+} GameState;
+
+typedef struct {
+    int rows, cols;            // Board size, walls included
+    uint64_t seed;             // Seed of the game's RNG
+    int speed;                 // Initial tick period in ms
+    int max_enemies;           // Enemy pool capacity
+} GameConfig;
+
+/* Host hooks */
+// the core never talks to the console; fatal errors go through the host's die()
+void die(const char *s);
+
+// every allocation made by the core goes through these, so hosts can count them
+typedef struct {
+    void *(*alloc)(size_t size);
+    void (*release)(void *ptr);
+} GameAllocator;
+
+void game_set_allocator(const GameAllocator *allocator);
+void *game_alloc(size_t size); // dies instead of returning NULL
+void game_release(void *ptr);
+
+/* Random numbers */
+void rng_seed(Rng *rng, uint64_t seed);
+uint32_t rng_next(Rng *rng);
+int rng_range(Rng *rng, int n); // uniform in [0, n)
+
+/* Grid API */
+int coordinates_to_index(const GameState *state, int row, int col);
+void cell_set(GameState *state, enum layer layer, int row, int col);
+void cell_clear(GameState *state, enum layer layer, int row, int col);
+int cell_test(const GameState *state, enum layer layer, int row, int col);
+char get_cell_state(const GameState *state, int row, int col); // glyph of the topmost layer
+void game_render_glyphs(const GameState *state, char *glyphs); // rows * cols display glyphs, row-major
+int game_count_free(const GameState *state);
+int game_nth_free(const GameState *state, int n); // row * cols + col, -1 past the last free cell
+int game_random_free(GameState *state); // uniformly random free cell, -1 when the board is full
+
+/* Snake body API */
+SnakeSegment *snake_head(SnakeBody *body);
+SnakeSegment *snake_tail(SnakeBody *body);
+void snake_push_head(SnakeBody *body, int x, int y);
+void snake_pop_tail(SnakeBody *body);
+
+/* Game API */
+void game_config_default(GameConfig *config);
+void game_init(GameState *state, const GameConfig *config);
+void game_reset(GameState *state, const GameConfig *config); // new game in the same memory, no allocation unless it grew
+void game_free(GameState *state);
+// make `state` a copy of `from` with one memcpy of from's arena prefix, whatever the snake's
+// length. state keeps its arena, stats and flow scratch: either a game of the same config,
+// or a snapshot slot of at least from->snapshot_bytes that is only ever copied back
+void game_copy(GameState *state, const GameState *from);
+void place_food(GameState *state);
+void place_enemy(GameState *state);
+int spawn_enemy(GameState *state, int x, int y);
+void compute_snake_position(GameState *state);
+void compute_enemy_position(GameState *state);
+void compute_game_state(GameState *state);
+
+// hash of everything the next ticks depend on (the flow field is derived from it),
+// equal states give equal checksums on every platform
+uint64_t game_checksum(const GameState *state);
+
+#endif
@@ -0,0 +1,44 @@
+#include "history.h"
+
+int history_capacity(const GameState *state, int ticks) {
+    size_t fit = HISTORY_BUDGET / (ARENA_SIZE(state->snapshot_bytes) + sizeof(GameState));
+    if (fit < HISTORY_MIN_SNAPSHOTS) return 0;
+    return fit < (size_t)ticks ? (int)fit : ticks;
+}
+
+void history_init(History *history, const GameState *state, int capacity) {
+    size_t bytes = state->snapshot_bytes;
+    if (capacity < 1) capacity = 1;
+    arena_init(&history->arena, ARENA_SIZE(capacity * sizeof(GameState)) + capacity * ARENA_SIZE(bytes));
+    history->slots = ARENA_NEW(&history->arena, GameState, capacity);
+    for (int i = 0; i < capacity; i++) {
+        arena_init_sub(&history->slots[i].arena, &history->arena, bytes);
+    }
+    history->capacity = capacity;
+    history_clear(history);
+}
+
+void history_free(History *history) {
+    arena_free(&history->arena);
+    history->slots = NULL;
+    history->capacity = history->count = 0;
+}
+
+void history_clear(History *history) {
+    history->newest = history->capacity - 1;
+    history->count = 0;
+}
+
+void history_push(History *history, const GameState *state) {
+    history->newest = history->newest + 1 == history->capacity ? 0 : history->newest + 1;
+    game_copy(&history->slots[history->newest], state);
+    if (history->count < history->capacity) history->count++;
+}
+
+int history_pop(History *history, GameState *state) {
+    if (history->count == 0) return 0;
+    game_copy(state, &history->slots[history->newest]);
+    history->newest = history->newest == 0 ? history->capacity - 1 : history->newest - 1;
+    history->count--;
+    return 1;
+}
@@ -0,0 +1,41 @@
+#ifndef SNAKE_HISTORY_H
+#define SNAKE_HISTORY_H
+
+/* Ring of game-state snapshots for the rewind key. Every array of a game
+   lives in its arena and the GameState struct holds the rest, so a snapshot
+   is one memcpy of the arena (up to the flow field's scratch arrays) plus the
+   struct (game_copy), whatever the snake's length. All the slots are carved out of one block reserved by history_init;
+   pushing and popping never allocate. */
+
+#include "game.h"
+
+#define HISTORY_SECONDS 5        // how far back the rewind key can go at the starting speed
+#define HISTORY_BUDGET (32 << 20) // bytes of snapshots, fewer seconds on big boards
+#define HISTORY_MIN_SNAPSHOTS 8   // below this rewind is off: each tick would copy a huge board
+
+typedef struct {
+    Arena arena;                 // Holds every slot's GameState and arena
+    GameState *slots;            // Snapshots, oldest overwritten first
+    int capacity;
+    int newest;                  // Slot of the last push
+    int count;                   // Snapshots held
+} History;
+
+// snapshots to keep for `ticks` ticks of games shaped like `state`, fewer when they don't
+// fit in HISTORY_BUDGET and 0 when not even HISTORY_MIN_SNAPSHOTS do
+int history_capacity(const GameState *state, int ticks);
+
+// room for `capacity` snapshots of games shaped like `state` (same config)
+void history_init(History *history, const GameState *state, int capacity);
+void history_free(History *history);
+
+// forget every snapshot, e.g. when a new game starts
+void history_clear(History *history);
+
+// snapshot the state, dropping the oldest one when full
+void history_push(History *history, const GameState *state);
+
+// restore the newest snapshot and drop it, 0 when there is none
+int history_pop(History *history, GameState *state);
+
+#endif
@@ -0,0 +1,55 @@
+#include <string.h>
+#include "input.h"
+
+void turn_queue_init(TurnQueue *queue) {
+    memset(queue, 0, sizeof(*queue));
+}
+
+static int is_reverse(enum direction a, enum direction b) {
+    return (a == UP && b == DOWN) || (a == DOWN && b == UP) ||
+           (a == LEFT && b == RIGHT) || (a == RIGHT && b == LEFT);
+}
+
+int turn_queue_push(TurnQueue *queue, enum direction current, enum direction dir, long long tick) {
+    // filter against where the snake will be heading once the queue has drained
+    enum direction last = queue->tail != queue->head
+        ? queue->turns[(queue->tail - 1) & (TURN_QUEUE_SIZE - 1)].dir
+        : current;
+    if (dir == last || is_reverse(last, dir)) return 0;
+
+    if (queue->tail - queue->head == TURN_QUEUE_SIZE) {
+        queue->dropped++;
+        return 0;
+    }
+    Turn *turn = &queue->turns[queue->tail++ & (TURN_QUEUE_SIZE - 1)];
+    turn->dir = dir;
+    turn->tick = tick;
+    return 1;
+}
+
+void turn_queue_clear(TurnQueue *queue) {
+    queue->head = queue->tail;
+}
+
+enum direction turn_queue_pop(TurnQueue *queue, long long tick) {
+    if (queue->tail == queue->head) return NONE;
+    Turn *turn = &queue->turns[queue->head++ & (TURN_QUEUE_SIZE - 1)];
+
+    long long waited = tick - turn->tick;
+    if (waited >= TURN_LATENCY_BUCKETS) waited = TURN_LATENCY_BUCKETS - 1;
+    queue->latency[waited]++;
+    queue->applied++;
+    return turn->dir;
+}
+
+int turn_latency_percentile(const TurnQueue *queue, double percent) {
+    if (queue->applied == 0) return 0;
+    long long rank = (long long)(queue->applied * percent / 100.0);
+    if (rank >= queue->applied) rank = queue->applied - 1;
+    long long seen = 0;
+    for (int i = 0; i < TURN_LATENCY_BUCKETS; i++) {
+        seen += queue->latency[i];
+        if (seen > rank) return i;
+    }
+    return TURN_LATENCY_BUCKETS - 1;
+}
@@ -0,0 +1,43 @@
+#ifndef SNAKE_INPUT_H
+#define SNAKE_INPUT_H
+
+/* Buffered direction changes. The front end drains every pending key event
+   at once and queues the turns; the loop applies one per tick, so two quick
+   presses (up then left) become two moves instead of the second overwriting
+   the first. Each turn remembers the tick it was read on, which gives the
+   input-to-move latency in ticks. */
+
+#include "game.h"
+
+#define TURN_QUEUE_SIZE 4        // power of two, presses past this are dropped
+#define TURN_LATENCY_BUCKETS 16  // ticks waited, the last bucket counts everything slower
+
+typedef struct {
+    enum direction dir;          // Requested direction
+    long long tick;              // Tick count when the key was read
+} Turn;
+
+typedef struct {
+    Turn turns[TURN_QUEUE_SIZE]; // Ring storage
+    unsigned head, tail;         // Free-running indices, tail - head turns are queued
+    long long dropped;           // Presses lost to a full queue
+    long long applied;           // Turns that reached the snake
+    long long latency[TURN_LATENCY_BUCKETS]; // Applied turns by ticks waited
+} TurnQueue;
+
+void turn_queue_init(TurnQueue *queue);
+
+// queue a turn unless it reverses (or repeats) the last queued direction, or
+// `current` when nothing is queued. returns 1 when the turn was queued
+int turn_queue_push(TurnQueue *queue, enum direction current, enum direction dir, long long tick);
+
+// drop the queued turns, they were meant for a state that is gone
+void turn_queue_clear(TurnQueue *queue);
+
+// the next turn for the tick about to run, NONE when the queue is empty
+enum direction turn_queue_pop(TurnQueue *queue, long long tick);
+
+// smallest number of ticks that `percent` of the applied turns waited at most
+int turn_latency_percentile(const TurnQueue *queue, double percent);
+
+#endif
@@ -0,0 +1,238 @@
+#include <string.h>
+#include "presenter.h"
+#include "term.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+
+/* Threads */
+#ifdef _WIN32
+struct PresenterSync {
+    volatile LONG middle;        // Slot between the threads, | PRESENTER_FRESH until taken
+    volatile LONG stop;
+    volatile LONG repaint;       // The next frame drawn repaints the whole screen
+    volatile LONG waiting;       // The render thread is about to sleep, publish has to wake it
+    HANDLE wake;                 // Auto-reset event: a publish never blocks on the render thread
+    HANDLE thread;
+};
+
+static int swap_middle(PresenterSync *sync, int slot) {
+    return (int)InterlockedExchange(&sync->middle, slot);
+}
+
+// a compare-exchange that never matches is a load with a barrier
+static int peek_middle(PresenterSync *sync) {
+    return (int)InterlockedCompareExchange(&sync->middle, -1, -1);
+}
+
+static int stopping(PresenterSync *sync) {
+    return (int)InterlockedCompareExchange(&sync->stop, -1, -1);
+}
+
+static int take_repaint(PresenterSync *sync) {
+    return (int)InterlockedExchange(&sync->repaint, 0);
+}
+
+static void set_waiting(PresenterSync *sync, int waiting) {
+    InterlockedExchange(&sync->waiting, waiting);
+}
+
+static int is_waiting(PresenterSync *sync) {
+    return (int)InterlockedCompareExchange(&sync->waiting, -1, -1);
+}
+
+static void wake(PresenterSync *sync) {
+    SetEvent(sync->wake);
+}
+
+static void sleep_until_woken(PresenterSync *sync) {
+    WaitForSingleObject(sync->wake, INFINITE);
+}
+#else
+struct PresenterSync {
+    atomic_int middle;           // Slot between the threads, | PRESENTER_FRESH until taken
+    atomic_int stop;
+    atomic_int repaint;          // The next frame drawn repaints the whole screen
+    atomic_int waiting;          // The render thread is about to sleep, publish has to wake it
+    pthread_mutex_t lock;        // Guards woken for the sleep, never the frames
+    pthread_cond_t wake;
+    int woken;
+    pthread_t thread;
+};
+
+// sequentially consistent: a publish and the render thread going to sleep each write one
+// flag and read the other's, and at least one of them has to see the other's write
+static int swap_middle(PresenterSync *sync, int slot) {
+    return atomic_exchange(&sync->middle, slot);
+}
+
+static int peek_middle(PresenterSync *sync) {
+    return atomic_load(&sync->middle);
+}
+
+static int stopping(PresenterSync *sync) {
+    return atomic_load_explicit(&sync->stop, memory_order_acquire);
+}
+
+static int take_repaint(PresenterSync *sync) {
+    return atomic_exchange_explicit(&sync->repaint, 0, memory_order_acq_rel);
+}
+
+static void set_waiting(PresenterSync *sync, int waiting) {
+    atomic_store(&sync->waiting, waiting);
+}
+
+static int is_waiting(PresenterSync *sync) {
+    return atomic_load(&sync->waiting);
+}
+
+static void wake(PresenterSync *sync) {
+    pthread_mutex_lock(&sync->lock);
+    sync->woken = 1;
+    pthread_cond_signal(&sync->wake);
+    pthread_mutex_unlock(&sync->lock);
+}
+
+static void sleep_until_woken(PresenterSync *sync) {
+    pthread_mutex_lock(&sync->lock);
+    while (!sync->woken) pthread_cond_wait(&sync->wake, &sync->lock);
+    sync->woken = 0;
+    pthread_mutex_unlock(&sync->lock);
+}
+#endif
+
+/* Render thread */
+// swap the render thread's slot for the middle one when it holds a frame not drawn yet
+static Frame *take_frame(Presenter *presenter) {
+    if (!(peek_middle(presenter->sync) & PRESENTER_FRESH)) return NULL;
+    // only the game thread sets the flag, so the middle slot is still fresh here
+    presenter->read = swap_middle(presenter->sync, presenter->read) & ~PRESENTER_FRESH;
+    return &presenter->slots[presenter->read];
+}
+
+static void draw_frame(Presenter *presenter, const Frame *frame) {
+    Renderer *renderer = presenter->renderer;
+    if (take_repaint(presenter->sync)) renderer_invalidate(renderer);
+    int64_t start = stats_begin(presenter->stats);
+    size_t len = render_glyphs(renderer, frame->glyphs, frame->score);
+    stats_end(presenter->stats, PHASE_COMPOSE, start);
+
+    // write the entire composed buffer to the console at once
+    if (len > 0) {
+        start = stats_begin(presenter->stats);
+        term_write(renderer->frame, len);
+        stats_end(presenter->stats, PHASE_WRITE, start);
+        if (presenter->stats) histogram_record(&presenter->stats->frame_bytes, (int64_t)len);
+    }
+    presenter->drawn++;
+}
+
+static void render_loop(Presenter *presenter) {
+    for (;;) {
+        // checked before taking the frame, so the one published right before stop is drawn
+        int stop = stopping(presenter->sync);
+        Frame *frame = take_frame(presenter);
+        if (frame) {
+            draw_frame(presenter, frame);
+        } else if (stop) {
+            break;
+        } else {
+            // announce the sleep, then look once more: a frame published in between either
+            // shows up here or sees the flag and wakes us
+            set_waiting(presenter->sync, 1);
+            if (!(peek_middle(presenter->sync) & PRESENTER_FRESH) && !stopping(presenter->sync)) {
+                sleep_until_woken(presenter->sync);
+            }
+            set_waiting(presenter->sync, 0);
+        }
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI render_main(LPVOID arg) {
+    render_loop(arg);
+    return 0;
+}
+#else
+static void *render_main(void *arg) {
+    render_loop(arg);
+    return NULL;
+}
+#endif
+
+/* Presenter API */
+void presenter_start(Presenter *presenter, Renderer *renderer, Stats *stats) {
+    size_t area = (size_t)renderer->rows * renderer->cols;
+    memset(presenter, 0, sizeof(*presenter));
+    arena_init(&presenter->arena, PRESENTER_SLOTS * ARENA_SIZE(area) + ARENA_SIZE(sizeof(PresenterSync)));
+    for (int i = 0; i < PRESENTER_SLOTS; i++) {
+        presenter->slots[i].glyphs = ARENA_NEW(&presenter->arena, char, area);
+    }
+    presenter->renderer = renderer;
+    presenter->stats = stats;
+    // slot 0 is the game thread's, 1 the render thread's and 2 starts in the middle
+    presenter->write = 0;
+    presenter->read = 1;
+
+    PresenterSync *sync = ARENA_NEW(&presenter->arena, PresenterSync, 1);
+    presenter->sync = sync;
+#ifdef _WIN32
+    sync->middle = 2;
+    sync->wake = CreateEventA(NULL, FALSE, FALSE, NULL);
+    if (!sync->wake) die("CreateEvent");
+    sync->thread = CreateThread(NULL, 0, render_main, presenter, 0, NULL);
+    if (!sync->thread) die("CreateThread");
+#else
+    atomic_init(&sync->middle, 2);
+    atomic_init(&sync->stop, 0);
+    atomic_init(&sync->repaint, 0);
+    atomic_init(&sync->waiting, 0);
+    pthread_mutex_init(&sync->lock, NULL);
+    pthread_cond_init(&sync->wake, NULL);
+    if (pthread_create(&sync->thread, NULL, render_main, presenter)) die("pthread_create");
+#endif
+}
+
+void presenter_stop(Presenter *presenter) {
+    PresenterSync *sync = presenter->sync;
+    if (!sync) return;
+#ifdef _WIN32
+    InterlockedExchange(&sync->stop, 1);
+    wake(sync);
+    WaitForSingleObject(sync->thread, INFINITE);
+    CloseHandle(sync->thread);
+    CloseHandle(sync->wake);
+#else
+    atomic_store_explicit(&sync->stop, 1, memory_order_release);
+    wake(sync);
+    pthread_join(sync->thread, NULL);
+    pthread_mutex_destroy(&sync->lock);
+    pthread_cond_destroy(&sync->wake);
+#endif
+    arena_free(&presenter->arena);
+    presenter->sync = NULL;
+}
+
+void presenter_invalidate(Presenter *presenter) {
+#ifdef _WIN32
+    InterlockedExchange(&presenter->sync->repaint, 1);
+#else
+    atomic_store_explicit(&presenter->sync->repaint, 1, memory_order_release);
+#endif
+}
+
+Frame *presenter_frame(Presenter *presenter) {
+    return &presenter->slots[presenter->write];
+}
+
+void presenter_publish(Presenter *presenter) {
+    int old = swap_middle(presenter->sync, presenter->write | PRESENTER_FRESH);
+    if (old & PRESENTER_FRESH) presenter->replaced++;
+    presenter->write = old & ~PRESENTER_FRESH;
+    presenter->published++;
+    // while the render thread is busy drawing it finds the frame on its own, no system call
+    if (is_waiting(presenter->sync)) wake(presenter->sync);
+}
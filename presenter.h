@@ -0,0 +1,55 @@
+#ifndef SNAKE_PRESENTER_H
+#define SNAKE_PRESENTER_H
+
+/* Render thread. The game thread snapshots the board's glyphs into a frame
+   and publishes it; a thread of its own composes it with the Renderer and
+   writes it to the terminal, so a slow terminal makes frames drop instead of
+   making ticks late.
+
+   Frames go through a triple buffer: the game thread fills its own slot and
+   swaps it with the middle one, the render thread swaps its slot with the
+   middle one when a fresh frame is there. Each swap is one atomic exchange,
+   nobody waits for the other, and a frame published before the last one was
+   drawn simply replaces it. The render thread sleeps between frames and is
+   woken on publish. */
+
+#include "render.h"
+#include "stats.h"
+
+#define PRESENTER_SLOTS 3
+#define PRESENTER_FRESH 4 // set in `middle` until the render thread takes the frame
+
+typedef struct {
+    char *glyphs;                // rows * cols glyphs, from game_render_glyphs
+    int score;                   // For the HUD
+} Frame;
+
+typedef struct PresenterSync PresenterSync;
+
+typedef struct {
+    Arena arena;                 // Every slot's glyphs and the sync block
+    Frame slots[PRESENTER_SLOTS];
+    PresenterSync *sync;         // The middle slot, the thread and its wake-up, per platform
+    int write;                   // Game thread's slot
+    int read;                    // Render thread's slot
+    Renderer *renderer;          // Used by the render thread only while it runs
+    Stats *stats;                // Compose and write timers, NULL when off
+    long long published;         // Frames handed over
+    long long replaced;          // Frames replaced by a newer one before they were drawn
+    long long drawn;             // Frames composed and written
+} Presenter;
+
+// start the render thread; the renderer is its own until presenter_stop
+void presenter_start(Presenter *presenter, Renderer *renderer, Stats *stats);
+
+// draw the last frame published, stop the thread and free the slots
+void presenter_stop(Presenter *presenter);
+
+// the screen was lost (terminal resized): the next frame drawn repaints everything
+void presenter_invalidate(Presenter *presenter);
+
+// the game thread's slot, to fill then publish
+Frame *presenter_frame(Presenter *presenter);
+void presenter_publish(Presenter *presenter);
+
+#endif
@@ -0,0 +1,220 @@
+#include <string.h>
+#include "render.h"
+
+/* Byte tables */
+typedef struct {
+    const char *bytes;
+    size_t len;
+} ByteSeq;
+
+#define BYTES(s) { s, sizeof(s) - 1 }
+
+// one escape sequence per colour class, indexed by enum sgr
+static const ByteSeq sgr_seq[] = {
+    [SGR_DEFAULT] = BYTES(COLOR_RESET),
+    [SGR_SNAKE] = BYTES(COLOR_SNAKE),
+    [SGR_FOOD] = BYTES(COLOR_FOOD),
+    [SGR_RIVAL] = BYTES(COLOR_RIVAL),
+};
+
+// colour class of every glyph, anything not listed is drawn in the default colour
+static const unsigned char glyph_sgr[256] = {
+    [SNAKE_HEAD_CHAR] = SGR_SNAKE,
+    [SNAKE_BODY_CHAR] = SGR_SNAKE,
+    [FOOD_CHAR] = SGR_FOOD,
+    [RIVAL_HEAD_CHAR] = SGR_RIVAL,
+    [RIVAL_BODY_CHAR] = SGR_RIVAL,
+};
+
+static const ByteSeq hud_help = BYTES("Use arrow keys to move the snake, eat the '$' before it gets eaten" ESC "[K\n");
+static const ByteSeq hud_power = BYTES("New Power unlocked: Snake can now wrap around walls" ESC "[K\n");
+static const ByteSeq hud_score = BYTES("Score: ");
+static const ByteSeq hud_end = BYTES(ESC "[K\n");
+
+#define PUT_BYTES(p, seq) (memcpy((p), (seq).bytes, (seq).len), (p) += (seq).len)
+
+// decimal digits without going through printf
+static char *put_uint(char *p, unsigned int n) {
+    char digits[10];
+    int len = 0;
+    do {
+        digits[len++] = (char)('0' + n % 10);
+        n /= 10;
+    } while (n);
+    while (len) *p++ = digits[--len];
+    return p;
+}
+
+// ESC [ row ; col H, 1-based
+static char *put_cursor(char *p, int row, int col) {
+    *p++ = '\x1b';
+    *p++ = '[';
+    p = put_uint(p, (unsigned int)row);
+    *p++ = ';';
+    p = put_uint(p, (unsigned int)col);
+    *p++ = 'H';
+    return p;
+}
+
+// switch colour only when the cell's class differs from the one already active.
+// *active is a local copy of renderer->sgr, writes through p could alias the field
+static char *put_cell(char *p, int *active, char cell) {
+    int sgr = glyph_sgr[(unsigned char)cell];
+    if (sgr != *active) {
+        PUT_BYTES(p, sgr_seq[sgr]);
+        *active = sgr;
+    }
+    *p++ = cell;
+    return p;
+}
+
+static char *put_sgr_default(Renderer *renderer, char *p) {
+    if (renderer->sgr != SGR_DEFAULT) {
+        PUT_BYTES(p, sgr_seq[SGR_DEFAULT]);
+        renderer->sgr = SGR_DEFAULT;
+    }
+    return p;
+}
+
+static char *put_hud(Renderer *renderer, char *p, int score) {
+    p = put_sgr_default(renderer, p);
+    if (score >= LEVEL_UPGRADE_SCORE) {
+        PUT_BYTES(p, hud_power);
+    } else {
+        PUT_BYTES(p, hud_help);
+    }
+    PUT_BYTES(p, hud_score);
+    p = put_uint(p, (unsigned int)score);
+    PUT_BYTES(p, hud_end);
+    return p;
+}
+
+void renderer_init(Renderer *renderer, int full_redraw, int rows, int cols) {
+    size_t area = (size_t)rows * cols;
+    size_t runs_per_row = cols / (RUN_MERGE_GAP + 1) + 1;
+    renderer->rows = rows;
+    renderer->cols = cols;
+    renderer->hud_row = GRID_SCREEN_ROW + rows;
+    // full frames pay one newline per row, delta frames one cursor move per run
+    renderer->frame_max = 32 + area * RENDER_CELL_MAX +
+                          rows * (1 + runs_per_row * RENDER_CURSOR_MAX) + RENDER_HUD_MAX;
+    // one block for the three buffers
+    arena_init(&renderer->arena, 2 * ARENA_SIZE(area) + ARENA_SIZE(renderer->frame_max));
+    renderer->back = ARENA_NEW(&renderer->arena, char, area);
+    renderer->front = ARENA_NEW(&renderer->arena, char, area);
+    renderer->frame = ARENA_NEW(&renderer->arena, char, renderer->frame_max);
+    renderer->full_redraw = full_redraw;
+    renderer->sgr = SGR_DEFAULT;
+    renderer_invalidate(renderer);
+}
+
+void renderer_free(Renderer *renderer) {
+    arena_free(&renderer->arena);
+    renderer->back = renderer->front = renderer->frame = NULL;
+}
+
+// forget what is on screen, the next frame repaints everything
+void renderer_invalidate(Renderer *renderer) {
+    renderer->front_valid = 0;
+    renderer->hud_score = -1;
+}
+
+// the whole grid, top to bottom
+static size_t render_full(Renderer *renderer, const char *glyphs, int score, int clear) {
+    static const ByteSeq home = BYTES(ESC "[H");
+    static const ByteSeq wipe = BYTES(ESC "[2J");
+    static const ByteSeq hide_cursor = BYTES(ESC "[?25l");
+    char *p = renderer->frame;
+
+    PUT_BYTES(p, home);
+    if (clear) PUT_BYTES(p, wipe);
+    // hide the cursor at the beginning of the draw cycle
+    PUT_BYTES(p, hide_cursor);
+
+    *p++ = '\n';
+
+    // iterate through each cell of the grid
+    int sgr = renderer->sgr;
+    int rows = renderer->rows, cols = renderer->cols;
+    for (int i = 0; i < rows; i++) {
+        const char *row = glyphs + (size_t)i * cols;
+        for (int j = 0; j < cols; j++) {
+            p = put_cell(p, &sgr, row[j]);
+        }
+        *p++ = '\n';
+    }
+    renderer->sgr = sgr;
+
+    // add game info text
+    p = put_hud(renderer, p, score);
+
+    memcpy(renderer->front, glyphs, (size_t)rows * cols);
+    renderer->front_valid = 1;
+    renderer->hud_score = score;
+    return p - renderer->frame;
+}
+
+// only the cells that differ from the front buffer, grouped in runs per row
+static size_t render_delta(Renderer *renderer, const char *glyphs, int score) {
+    char *p = renderer->frame;
+    int sgr = renderer->sgr;
+
+    int rows = renderer->rows, cols = renderer->cols;
+
+    for (int i = 0; i < rows; i++) {
+        const char *back = glyphs + (size_t)i * cols;
+        char *front = renderer->front + (size_t)i * cols;
+        // most rows did not change at all
+        if (!memcmp(back, front, cols)) continue;
+
+        int j = 0;
+        while (j < cols) {
+            if (back[j] == front[j]) {
+                j++;
+                continue;
+            }
+            // extend the run while the next change is close enough
+            int end = j + 1;
+            for (int k = end; k < cols && k - end < RUN_MERGE_GAP; k++) {
+                if (back[k] != front[k]) end = k + 1;
+            }
+
+            // the active colour survives cursor moves, no need to reset it
+            p = put_cursor(p, GRID_SCREEN_ROW + i, j + 1);
+            for (int k = j; k < end; k++) {
+                p = put_cell(p, &sgr, back[k]);
+                front[k] = back[k];
+            }
+            j = end;
+        }
+    }
+    renderer->sgr = sgr;
+
+    if (score != renderer->hud_score) {
+        p = put_cursor(p, renderer->hud_row, 1);
+        p = put_hud(renderer, p, score);
+        renderer->hud_score = score;
+    }
+    return p - renderer->frame;
+}
+
+size_t render_frame(Renderer *renderer, const GameState *state) {
+    // the simulation only keeps bitboards, glyphs exist for the time of a draw
+    game_render_glyphs(state, renderer->back);
+    return render_glyphs(renderer, renderer->back, state->score);
+}
+
+size_t render_glyphs(Renderer *renderer, const char *glyphs, int score) {
+    size_t len;
+    if (renderer->full_redraw) {
+        len = render_full(renderer, glyphs, score, 0);
+    } else if (!renderer->front_valid) {
+        // the screen may hold anything on first draw or after a resize: wipe it first
+        len = render_full(renderer, glyphs, score, 1);
+    } else {
+        len = render_delta(renderer, glyphs, score);
+    }
+    // leave the terminal in the default colour between frames
+    char *end = put_sgr_default(renderer, renderer->frame + len);
+    return end - renderer->frame;
+}
@@ -0,0 +1,67 @@
+#ifndef SNAKE_RENDER_H
+#define SNAKE_RENDER_H
+
+/* Frame composer: turns a GameState into the bytes to write to the terminal.
+   The renderer remembers what is already on screen (the front buffer) and,
+   unless told to repaint everything, only emits the cells that changed.
+   Colours are tracked across the frame so an escape is only emitted where a
+   run of same-coloured cells starts. */
+
+#include <stddef.h>
+#include "game.h"
+
+#define ESC "\x1b"
+
+#define COLOR_RESET "\x1b[0m"
+#define COLOR_SNAKE "\x1b[33m" // yellow
+#define COLOR_FOOD "\x1b[32m" // green
+#define COLOR_RIVAL "\x1b[36m" // cyan
+
+// colour classes, each maps to one of the escapes above
+enum sgr {
+    SGR_DEFAULT = 0,
+    SGR_SNAKE,
+    SGR_FOOD,
+    SGR_RIVAL
+};
+
+// unchanged cells shorter than this between two changes are rewritten instead
+// of paying for another cursor-positioning escape
+#define RUN_MERGE_GAP 6
+
+// the grid starts on the second terminal line, the HUD sits right below it
+#define GRID_SCREEN_ROW 2
+#define HUD_LINES 2           // help or power line, then the score
+
+// worst cases of each piece of a frame
+#define RENDER_CELL_MAX 6     // colour escape + glyph
+#define RENDER_CURSOR_MAX 24  // ESC [ row ; col H with two 10-digit numbers
+#define RENDER_HUD_MAX 160    // colour reset, both HUD lines and a cursor move
+
+typedef struct {
+    int rows, cols;            // Size of the boards this renderer draws
+    int hud_row;               // Terminal line of the HUD, 1-based
+    Arena arena;               // Holds back, front and frame
+    char *back;                // Glyphs of the frame being composed, derived from the game's layers
+    char *front;               // Glyphs currently on the terminal
+    int front_valid;           // 0 forces a full repaint (first draw, resize)
+    int full_redraw;           // Repaint the whole grid every frame
+    int hud_score;             // Score currently shown in the HUD, -1 when unknown
+    int sgr;                   // Colour class active on the terminal while composing
+    char *frame;               // Composed frame, reused every draw
+    size_t frame_max;          // Worst-case frame size, what `frame` holds
+} Renderer;
+
+// buffers are sized for a rows x cols board, once
+void renderer_init(Renderer *renderer, int full_redraw, int rows, int cols);
+void renderer_free(Renderer *renderer);
+void renderer_invalidate(Renderer *renderer);
+
+// compose the next frame into renderer->frame, returns its length.
+// 0 means nothing changed and there is nothing to write
+size_t render_frame(Renderer *renderer, const GameState *state);
+
+// the same from glyphs game_render_glyphs wrote earlier, e.g. on another thread
+size_t render_glyphs(Renderer *renderer, const char *glyphs, int score);
+
+#endif
@@ -0,0 +1,244 @@
+#include <limits.h>
+#include <string.h>
+#include "replay.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const unsigned char replay_magic[4] = { 'S', 'N', 'K', 'R' };
+
+/* Recording */
+static void recorder_flush(Recorder *recorder) {
+    if (recorder->used && fwrite(recorder->buffer, 1, recorder->used, recorder->file) != recorder->used) {
+        recorder->failed = 1;
+    }
+    recorder->used = 0;
+}
+
+static void put_bytes(Recorder *recorder, const unsigned char *bytes, size_t count) {
+    if (recorder->used + count > RECORDER_BUFFER_SIZE) recorder_flush(recorder);
+    memcpy(recorder->buffer + recorder->used, bytes, count);
+    recorder->used += count;
+}
+
+static void put_varint(Recorder *recorder, uint64_t value) {
+    unsigned char bytes[10];
+    size_t count = 0;
+    while (value >= 0x80) {
+        bytes[count++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    bytes[count++] = (unsigned char)value;
+    put_bytes(recorder, bytes, count);
+}
+
+static void put_record(Recorder *recorder, long long tick, enum replay_kind kind) {
+    put_varint(recorder, (uint64_t)(tick - recorder->last_tick) << 2 | kind);
+    recorder->last_tick = tick;
+}
+
+int recorder_open(Recorder *recorder, const char *path, const GameConfig *config) {
+    memset(recorder, 0, sizeof(*recorder));
+    recorder->file = fopen(path, "wb");
+    if (!recorder->file) return 0;
+    recorder->checksum_interval = REPLAY_CHECKSUM_INTERVAL;
+
+    put_bytes(recorder, replay_magic, sizeof(replay_magic));
+    put_varint(recorder, REPLAY_VERSION);
+    put_varint(recorder, (uint64_t)config->rows);
+    put_varint(recorder, (uint64_t)config->cols);
+    put_varint(recorder, (uint64_t)config->speed);
+    put_varint(recorder, (uint64_t)config->max_enemies);
+    put_varint(recorder, config->seed);
+    put_varint(recorder, (uint64_t)recorder->checksum_interval);
+    return 1;
+}
+
+void recorder_turn(Recorder *recorder, long long tick, enum direction dir) {
+    unsigned char byte = (unsigned char)dir;
+    put_record(recorder, tick, REPLAY_TURN);
+    put_bytes(recorder, &byte, 1);
+}
+
+void recorder_tick_done(Recorder *recorder, long long ticks, const GameState *state) {
+    if (ticks % recorder->checksum_interval) return;
+    uint64_t checksum = game_checksum(state);
+    unsigned char bytes[8];
+    for (int i = 0; i < 8; i++) bytes[i] = (unsigned char)(checksum >> (8 * i));
+    put_record(recorder, ticks, REPLAY_CHECKSUM);
+    put_bytes(recorder, bytes, sizeof(bytes));
+}
+
+int recorder_close(Recorder *recorder, long long ticks) {
+    if (!recorder->file) return 0;
+    put_record(recorder, ticks, REPLAY_END);
+    recorder_flush(recorder);
+    if (fclose(recorder->file)) recorder->failed = 1;
+    recorder->file = NULL;
+    return !recorder->failed;
+}
+
+/* Replaying */
+// 0 when the data ends inside the varint or it doesn't fit 64 bits
+static int get_varint(Replay *replay, uint64_t *value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && replay->pos < replay->size; shift += 7) {
+        unsigned char byte = replay->data[replay->pos++];
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void replay_fail(Replay *replay, enum replay_status status) {
+    replay->status = status;
+    replay->bad_tick = replay->next_tick;
+    replay->next_kind = REPLAY_END;
+}
+
+// decode the header of the record at pos
+static void next_record(Replay *replay) {
+    // a recording cut off between two records (the game crashed) still plays up to there
+    if (replay->pos == replay->size) {
+        replay->next_kind = REPLAY_END;
+        return;
+    }
+    uint64_t header;
+    if (!get_varint(replay, &header) || (header & 3) > REPLAY_CHECKSUM) {
+        replay_fail(replay, REPLAY_CORRUPT);
+        return;
+    }
+    replay->next_tick += (long long)(header >> 2);
+    replay->next_kind = (enum replay_kind)(header & 3);
+}
+
+static int map_file(Replay *replay, const char *path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    CloseHandle(file); // the mapping keeps the file open
+    if (!mapping) return 0;
+    const void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        CloseHandle(mapping);
+        return 0;
+    }
+    replay->data = data;
+    replay->size = (size_t)size.QuadPart;
+    replay->mapping = mapping;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd); // the mapping keeps the file open
+    if (data == MAP_FAILED) return 0;
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+    replay->data = data;
+    replay->size = (size_t)st.st_size;
+    replay->mapping = data;
+#endif
+    return 1;
+}
+
+// a header field fits an int and is at least `min`
+static int field_in_range(uint64_t value, int min) {
+    return value >= (uint64_t)min && value <= INT_MAX;
+}
+
+int replay_open(Replay *replay, const char *path) {
+    memset(replay, 0, sizeof(*replay));
+    if (!map_file(replay, path)) return 0;
+
+    uint64_t fields[7];
+    int ok = replay->size >= sizeof(replay_magic) && !memcmp(replay->data, replay_magic, sizeof(replay_magic));
+    replay->pos = sizeof(replay_magic);
+    for (int i = 0; ok && i < 7; i++) ok = get_varint(replay, &fields[i]);
+    // the ranges --rows, --cols, --speed and --max-enemies accept, and a board game_reset can
+    // size without overflowing rows * cols
+    ok = ok && fields[0] == REPLAY_VERSION && field_in_range(fields[1], MIN_GRID_ROWS) &&
+         field_in_range(fields[2], MIN_GRID_COLS) && fields[1] * fields[2] <= INT_MAX &&
+         field_in_range(fields[3], 1) && field_in_range(fields[4], 0) && field_in_range(fields[6], 1);
+    if (!ok) {
+        replay_close(replay);
+        return 0;
+    }
+    game_config_default(&replay->config);
+    replay->config.rows = (int)fields[1];
+    replay->config.cols = (int)fields[2];
+    replay->config.speed = (int)fields[3];
+    replay->config.max_enemies = (int)fields[4];
+    replay->config.seed = fields[5];
+    replay->checksum_interval = (int)fields[6];
+    next_record(replay);
+    return 1;
+}
+
+void replay_close(Replay *replay) {
+    if (!replay->mapping) return;
+#ifdef _WIN32
+    UnmapViewOfFile(replay->data);
+    CloseHandle(replay->mapping);
+#else
+    munmap(replay->mapping, replay->size);
+#endif
+    replay->mapping = NULL;
+    replay->data = NULL;
+}
+
+enum direction replay_turn(Replay *replay, long long tick) {
+    enum direction dir = NONE;
+    while (replay->next_kind == REPLAY_TURN && replay->next_tick <= tick) {
+        if (replay->next_tick < tick || replay->pos == replay->size || replay->data[replay->pos] > RIGHT) {
+            replay_fail(replay, REPLAY_CORRUPT);
+            return NONE;
+        }
+        dir = (enum direction)replay->data[replay->pos++];
+        next_record(replay);
+    }
+    return dir;
+}
+
+int replay_check(Replay *replay, long long ticks, const GameState *state) {
+    while (replay->status == REPLAY_OK && replay->next_kind == REPLAY_CHECKSUM && replay->next_tick <= ticks) {
+        if (replay->next_tick < ticks || replay->size - replay->pos < 8) {
+            replay_fail(replay, REPLAY_CORRUPT);
+            break;
+        }
+        uint64_t expected = 0;
+        for (int i = 0; i < 8; i++) expected |= (uint64_t)replay->data[replay->pos++] << (8 * i);
+        if (game_checksum(state) != expected) {
+            replay_fail(replay, REPLAY_DIVERGED);
+            break;
+        }
+        replay->checked++;
+        next_record(replay);
+    }
+    // the recorded game ended right here or the replay took a different path
+    if (replay->status == REPLAY_OK && state->game_over &&
+        !(replay->next_kind == REPLAY_END && replay->next_tick == ticks)) {
+        replay->next_tick = ticks;
+        replay_fail(replay, REPLAY_DIVERGED);
+    }
+    return replay->status == REPLAY_OK;
+}
+
+int replay_done(const Replay *replay, long long ticks) {
+    return replay->status != REPLAY_OK || (replay->next_kind == REPLAY_END && ticks >= replay->next_tick);
+}
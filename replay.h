@@ -0,0 +1,82 @@
+#ifndef SNAKE_REPLAY_H
+#define SNAKE_REPLAY_H
+
+/* Deterministic record and replay. The core is a pure function of its config
+   (seed included) and the direction applied before each tick, so a recording
+   is the config followed by the turns, each a varint holding the distance in
+   ticks from the previous record. A checksum of the game state goes in every
+   REPLAY_CHECKSUM_INTERVAL ticks so a replay that drifts from the recorded
+   game (a changed rule, a platform difference) stops at the first tick it
+   can prove is wrong instead of silently playing something else.
+
+   File layout, all integers LEB128 varints unless noted:
+     "SNKR" version rows cols speed max_enemies seed checksum_interval
+     records: varint(tick delta << 2 | kind), then
+       REPLAY_TURN      one byte, the enum direction applied before that tick
+       REPLAY_CHECKSUM  8 bytes little endian, game_checksum once that many ticks ran
+       REPLAY_END       nothing, the tick count the recording stopped at */
+
+#include <stdio.h>
+#include "game.h"
+
+#define REPLAY_VERSION 1
+#define REPLAY_CHECKSUM_INTERVAL 64 // ticks between two state checksums
+#define RECORDER_BUFFER_SIZE 4096   // bytes buffered before a write
+
+enum replay_kind {
+    REPLAY_END = 0,
+    REPLAY_TURN,
+    REPLAY_CHECKSUM
+};
+
+enum replay_status {
+    REPLAY_OK = 0,
+    REPLAY_DIVERGED,             // a checksum didn't match
+    REPLAY_CORRUPT               // truncated or malformed record
+};
+
+typedef struct {
+    FILE *file;
+    unsigned char buffer[RECORDER_BUFFER_SIZE];
+    size_t used;                 // Bytes waiting in buffer
+    long long last_tick;         // Tick of the last record, deltas start from it
+    int checksum_interval;
+    int failed;                  // A write failed, the recording is incomplete
+} Recorder;
+
+typedef struct {
+    const unsigned char *data;   // The whole file, mapped read-only
+    size_t size;
+    size_t pos;                  // Next record
+    void *mapping;               // Platform handle kept for replay_close
+    GameConfig config;           // Config of the recorded game
+    int checksum_interval;
+    long long next_tick;         // Tick of the record at pos
+    enum replay_kind next_kind;
+    enum replay_status status;
+    long long checked;           // Checksums verified so far
+    long long bad_tick;          // Tick count where the replay diverged or the file broke
+} Replay;
+
+/* Recording */
+// writes the header, returns 0 when the file can't be created
+int recorder_open(Recorder *recorder, const char *path, const GameConfig *config);
+// call before the tick numbered `tick` (ticks run so far) when the snake turns
+void recorder_turn(Recorder *recorder, long long tick, enum direction dir);
+// call after each tick with the new tick count, adds a checksum every interval
+void recorder_tick_done(Recorder *recorder, long long ticks, const GameState *state);
+// writes the end record and closes the file, returns 0 if anything failed to write
+int recorder_close(Recorder *recorder, long long ticks);
+
+/* Replaying */
+// maps the file and reads the header, returns 0 when it can't be read or isn't a recording
+int replay_open(Replay *replay, const char *path);
+void replay_close(Replay *replay);
+// direction to apply before the tick numbered `tick`, NONE when the snake doesn't turn
+enum direction replay_turn(Replay *replay, long long tick);
+// call after each tick with the new tick count, returns 0 once the replay diverged or broke
+int replay_check(Replay *replay, long long ticks, const GameState *state);
+// the recording stopped at (or before) `ticks`, or can't be read any further
+int replay_done(const Replay *replay, long long ticks);
+
+#endif
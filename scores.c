@@ -0,0 +1,313 @@
+#include <stdlib.h>
+#include <string.h>
+#include "scores.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define INDEX_HEADER_SIZE 32
+#define INDEX_SLOT_SIZE (SCORE_RECORD_SIZE + 8) // record, then its journal offset
+
+static const unsigned char index_magic[4] = { 'S', 'N', 'K', 'I' };
+
+/* Encoding */
+static void put_u32(unsigned char *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_u64(unsigned char *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint32_t get_u32(const unsigned char *p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) v |= (uint32_t)p[i] << (8 * i);
+    return v;
+}
+
+static uint64_t get_u64(const unsigned char *p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+// FNV-1a over the fields, enough to spot a record a crash cut short
+static uint32_t record_checksum(const unsigned char *p) {
+    uint32_t hash = 0x811C9DC5u;
+    for (int i = 0; i < SCORE_RECORD_SIZE - 4; i++) hash = (hash ^ p[i]) * 0x01000193u;
+    return hash;
+}
+
+static void encode_record(unsigned char *p, const ScoreRecord *record) {
+    put_u32(p, (uint32_t)record->score);
+    put_u32(p + 4, (uint32_t)record->length);
+    put_u32(p + 8, (uint32_t)record->speed);
+    put_u64(p + 12, (uint64_t)record->ticks);
+    put_u64(p + 20, record->seed);
+    put_u64(p + 28, (uint64_t)record->time);
+    put_u32(p + 36, record_checksum(p));
+}
+
+static void decode_record(const unsigned char *p, ScoreRecord *record) {
+    record->score = (int32_t)get_u32(p);
+    record->length = (int32_t)get_u32(p + 4);
+    record->speed = (int32_t)get_u32(p + 8);
+    record->ticks = (int64_t)get_u64(p + 12);
+    record->seed = get_u64(p + 20);
+    record->time = (int64_t)get_u64(p + 28);
+}
+
+/* Files */
+#ifdef _WIN32
+static int open_files(ScoreBoard *board, const char *journal_path, const char *index_path) {
+    HANDLE journal = CreateFileA(journal_path, FILE_APPEND_DATA | FILE_READ_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                 NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (journal == INVALID_HANDLE_VALUE) return 0;
+    HANDLE index = CreateFileA(index_path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                               NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    // the mapping grows the file to its size
+    HANDLE mapping = index == INVALID_HANDLE_VALUE ? NULL :
+                     CreateFileMappingA(index, NULL, PAGE_READWRITE, 0, (DWORD)board->map_size, NULL);
+    void *map = mapping ? MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, board->map_size) : NULL;
+    if (!map) {
+        if (mapping) CloseHandle(mapping);
+        if (index != INVALID_HANDLE_VALUE) CloseHandle(index);
+        CloseHandle(journal);
+        return 0;
+    }
+    board->journal = (intptr_t)journal;
+    board->index = (intptr_t)index;
+    board->mapping = mapping;
+    board->map = map;
+    return 1;
+}
+
+static void close_files(ScoreBoard *board) {
+    UnmapViewOfFile(board->map);
+    CloseHandle(board->mapping);
+    CloseHandle((HANDLE)board->index);
+    CloseHandle((HANDLE)board->journal);
+}
+
+// every process that touches the index takes this first; 0 when it can't be taken
+static int lock_index(ScoreBoard *board) {
+    OVERLAPPED overlapped = { 0 };
+    return LockFileEx((HANDLE)board->index, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped) != 0;
+}
+
+static void unlock_index(ScoreBoard *board) {
+    OVERLAPPED overlapped = { 0 };
+    UnlockFileEx((HANDLE)board->index, 0, 1, 0, &overlapped);
+}
+
+static uint64_t journal_size(ScoreBoard *board) {
+    LARGE_INTEGER size;
+    return GetFileSizeEx((HANDLE)board->journal, &size) ? (uint64_t)size.QuadPart : 0;
+}
+
+static size_t journal_read(ScoreBoard *board, uint64_t offset, unsigned char *buf, size_t len) {
+    OVERLAPPED overlapped = { 0 };
+    overlapped.Offset = (DWORD)offset;
+    overlapped.OffsetHigh = (DWORD)(offset >> 32);
+    DWORD got = 0;
+    if (!ReadFile((HANDLE)board->journal, buf, (DWORD)len, &got, &overlapped)) return 0;
+    return got;
+}
+
+// the handle only has append access: every write lands at the end of the file, in one piece
+static int journal_append(ScoreBoard *board, const unsigned char *bytes, size_t len) {
+    DWORD written = 0;
+    return WriteFile((HANDLE)board->journal, bytes, (DWORD)len, &written, NULL) && written == len;
+}
+#else
+static int open_files(ScoreBoard *board, const char *journal_path, const char *index_path) {
+    int journal = open(journal_path, O_RDWR | O_APPEND | O_CREAT, 0644);
+    if (journal < 0) return 0;
+    int index = open(index_path, O_RDWR | O_CREAT, 0644);
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (index >= 0 && fstat(index, &st) == 0 &&
+        ((size_t)st.st_size >= board->map_size || ftruncate(index, (off_t)board->map_size) == 0)) {
+        map = mmap(NULL, board->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, index, 0);
+    }
+    if (map == MAP_FAILED) {
+        if (index >= 0) close(index);
+        close(journal);
+        return 0;
+    }
+    board->journal = journal;
+    board->index = index;
+    board->map = map;
+    return 1;
+}
+
+static void close_files(ScoreBoard *board) {
+    munmap(board->map, board->map_size);
+    close((int)board->index);
+    close((int)board->journal);
+}
+
+// every process that touches the index takes this first; 0 when it can't be taken (no lock
+// daemon for a file on NFS, say)
+static int lock_index(ScoreBoard *board) {
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    while (fcntl((int)board->index, F_SETLKW, &lock) < 0) {
+        if (errno != EINTR) return 0; // interrupted by a signal: wait again
+    }
+    return 1;
+}
+
+static void unlock_index(ScoreBoard *board) {
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_UNLCK;
+    lock.l_whence = SEEK_SET;
+    fcntl((int)board->index, F_SETLK, &lock);
+}
+
+static uint64_t journal_size(ScoreBoard *board) {
+    struct stat st;
+    return fstat((int)board->journal, &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+static size_t journal_read(ScoreBoard *board, uint64_t offset, unsigned char *buf, size_t len) {
+    ssize_t got = pread((int)board->journal, buf, len, (off_t)offset);
+    return got > 0 ? (size_t)got : 0;
+}
+
+// O_APPEND: the kernel moves to the end and writes in one step, whoever else is appending
+static int journal_append(ScoreBoard *board, const unsigned char *bytes, size_t len) {
+    return write((int)board->journal, bytes, len) == (ssize_t)len;
+}
+#endif
+
+/* Index */
+static unsigned char *slot(ScoreBoard *board, int i) {
+    return board->map + INDEX_HEADER_SIZE + (size_t)i * INDEX_SLOT_SIZE;
+}
+
+// a fresh index, one left by another version or another journal, or one a crash left
+// half-updated, starts over
+static void check_index(ScoreBoard *board, uint64_t size) {
+    unsigned char *header = board->map;
+    if (!memcmp(header, index_magic, 4) && get_u32(header + 4) == SCORES_VERSION &&
+        get_u32(header + 8) == SCORES_TOP && get_u32(header + 12) <= SCORES_TOP && get_u64(header + 16) <= size &&
+        get_u32(header + 24) == 0) {
+        return;
+    }
+    memcpy(header, index_magic, 4);
+    put_u32(header + 4, SCORES_VERSION);
+    put_u32(header + 8, SCORES_TOP);
+    put_u32(header + 12, 0);
+    put_u64(header + 16, 0);
+    put_u32(header + 24, 0);
+}
+
+// sorted by score, best first; a later game never passes an earlier one with the same score
+static int insert(ScoreBoard *board, const unsigned char *record, uint64_t offset) {
+    int count = (int)get_u32(board->map + 12);
+    int32_t score = (int32_t)get_u32(record);
+    int low = 0, high = count;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if ((int32_t)get_u32(slot(board, mid)) >= score) low = mid + 1;
+        else high = mid;
+    }
+    if (low == SCORES_TOP) return 0;
+
+    int moved = count < SCORES_TOP ? count - low : SCORES_TOP - 1 - low;
+    memmove(slot(board, low + 1), slot(board, low), (size_t)moved * INDEX_SLOT_SIZE);
+    memcpy(slot(board, low), record, SCORE_RECORD_SIZE);
+    put_u64(slot(board, low) + SCORE_RECORD_SIZE, offset);
+    if (count < SCORES_TOP) put_u32(board->map + 12, (uint32_t)count + 1);
+    return low + 1;
+}
+
+// index what was appended since the last time, by anyone; returns the rank the record at
+// `mine` got, 0 when it isn't in the index. call with the index locked
+static int catch_up(ScoreBoard *board, uint64_t mine) {
+    unsigned char buf[SCORES_READ_BATCH * SCORE_RECORD_SIZE];
+    uint64_t size = journal_size(board);
+    check_index(board, size);
+    uint64_t offset = get_u64(board->map + 16);
+    int rank = 0;
+    if (size - offset < SCORE_RECORD_SIZE) return rank;
+    // dirty while the slots move: a process dying in here leaves it set, and the next one
+    // rebuilds the index from the journal instead of trusting half a memmove
+    put_u32(board->map + 24, 1);
+    while (size - offset >= SCORE_RECORD_SIZE) {
+        uint64_t records = (size - offset) / SCORE_RECORD_SIZE;
+        size_t len = (size_t)(records < SCORES_READ_BATCH ? records : SCORES_READ_BATCH) * SCORE_RECORD_SIZE;
+        size_t got = journal_read(board, offset, buf, len) / SCORE_RECORD_SIZE * SCORE_RECORD_SIZE;
+        if (got == 0) break;
+        for (size_t at = 0; at < got; at += SCORE_RECORD_SIZE) {
+            const unsigned char *record = buf + at;
+            // the offset moves past each record as it goes in, never a batch at a time
+            put_u64(board->map + 16, offset + at + SCORE_RECORD_SIZE);
+            // a record a crash cut short fails here and is skipped
+            if (get_u32(record + 36) != record_checksum(record)) continue;
+            // a record that fell out later has no rank anyway, ranks only matter for `mine`
+            int placed = insert(board, record, offset + at);
+            if (offset + at == mine) rank = placed;
+        }
+        offset += got;
+    }
+    put_u32(board->map + 24, 0);
+    return rank;
+}
+
+/* Score board API */
+int scoreboard_open(ScoreBoard *board, const char *journal_path) {
+    memset(board, 0, sizeof(*board));
+    size_t len = strlen(journal_path);
+    char *index_path = malloc(len + sizeof(SCORES_INDEX_SUFFIX));
+    if (!index_path) return 0;
+    memcpy(index_path, journal_path, len);
+    memcpy(index_path + len, SCORES_INDEX_SUFFIX, sizeof(SCORES_INDEX_SUFFIX));
+    board->map_size = INDEX_HEADER_SIZE + (size_t)SCORES_TOP * INDEX_SLOT_SIZE;
+    int ok = open_files(board, journal_path, index_path);
+    free(index_path);
+    return ok;
+}
+
+void scoreboard_close(ScoreBoard *board) {
+    if (board->map) close_files(board);
+    memset(board, 0, sizeof(*board));
+}
+
+int scoreboard_add(ScoreBoard *board, const ScoreRecord *record) {
+    unsigned char bytes[2 * SCORE_RECORD_SIZE];
+    encode_record(bytes + SCORE_RECORD_SIZE, record);
+
+    if (!lock_index(board)) return -1;
+    // a record cut short by a crash is padded to a whole one (which fails its checksum),
+    // so the records after it stay aligned; written together with ours, in one piece
+    uint64_t size = journal_size(board);
+    size_t pad = (size_t)(size % SCORE_RECORD_SIZE ? SCORE_RECORD_SIZE - size % SCORE_RECORD_SIZE : 0);
+    memset(bytes + SCORE_RECORD_SIZE - pad, 0, pad);
+    int rank = -1;
+    if (journal_append(board, bytes + SCORE_RECORD_SIZE - pad, pad + SCORE_RECORD_SIZE)) {
+        rank = catch_up(board, size + pad);
+    }
+    unlock_index(board);
+    return rank;
+}
+
+int scoreboard_top(ScoreBoard *board, ScoreRecord *top, int max) {
+    if (!lock_index(board)) return 0;
+    catch_up(board, UINT64_MAX);
+    int count = (int)get_u32(board->map + 12);
+    if (count > max) count = max;
+    for (int i = 0; i < count; i++) decode_record(slot(board, i), &top[i]);
+    unlock_index(board);
+    return count;
+}
@@ -0,0 +1,61 @@
+#ifndef SNAKE_SCORES_H
+#define SNAKE_SCORES_H
+
+/* Score journal. Every finished game appends one fixed-size record to an
+   append-only file with a single write in append mode, so games running
+   side by side never interleave their records and a crash can only cut the
+   last one short (its checksum then fails and it is skipped).
+
+   Beside the journal, a memory-mapped index keeps the best SCORES_TOP
+   records sorted by score, and the journal offset it has read up to. Adding
+   a game, checking for a high score or listing the leaderboard first reads
+   what was appended since (by this process or any other), inserting each
+   record with a binary search, under a lock on the index file. The journal is
+   only read from the start when the index is missing or doesn't match it.
+
+   Record layout, 40 bytes little endian:
+     score (4) length (4) speed (4) ticks (8) seed (8) time (8) checksum (4)
+   Index layout: "SNKI" version top count (4 each) journal offset (8) dirty
+   (4, set while the slots are being rewritten) and 4 bytes of padding, then
+   `top` slots of a record followed by its journal offset (8). An index found
+   dirty was left by a process that died halfway and is rebuilt. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SCORES_JOURNAL "snake_scores.bin"
+#define SCORES_INDEX_SUFFIX ".idx"
+#define SCORES_VERSION 2
+#define SCORES_TOP 100             // records the index keeps
+#define SCORE_RECORD_SIZE 40
+#define SCORES_READ_BATCH 256      // journal records read per call while catching up
+
+typedef struct {
+    int32_t score;
+    int32_t length;              // Snake length at the end
+    int32_t speed;               // Initial tick period in ms
+    int64_t ticks;               // Ticks played
+    uint64_t seed;
+    int64_t time;                // Unix time the game ended
+} ScoreRecord;
+
+typedef struct {
+    intptr_t journal;            // File descriptors, HANDLEs on Windows
+    intptr_t index;
+    void *mapping;               // Handle of the index mapping on Windows
+    unsigned char *map;          // The index: header, then SCORES_TOP slots
+    size_t map_size;
+} ScoreBoard;
+
+// open or create the journal and its index, 0 when either can't be opened
+int scoreboard_open(ScoreBoard *board, const char *journal_path);
+void scoreboard_close(ScoreBoard *board);
+
+// append one game: its rank among the best (1 is a new high score), 0 when it didn't
+// make the index, -1 when the index couldn't be locked or the record couldn't be written
+int scoreboard_add(ScoreBoard *board, const ScoreRecord *record);
+
+// the best `max` games, best first; returns how many there are, 0 when the index can't be locked
+int scoreboard_top(ScoreBoard *board, ScoreRecord *top, int max);
+
+#endif
@@ -0,0 +1,244 @@
+#include <string.h>
+#include "sim.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+/* Threads */
+#ifdef _WIN32
+typedef SRWLOCK Mutex;
+#define mutex_init(m) InitializeSRWLock(m)
+#define mutex_lock(m) AcquireSRWLockExclusive(m)
+#define mutex_unlock(m) ReleaseSRWLockExclusive(m)
+#define mutex_destroy(m) ((void)(m))
+#else
+typedef pthread_mutex_t Mutex;
+#define mutex_init(m) pthread_mutex_init((m), NULL)
+#define mutex_lock(m) pthread_mutex_lock(m)
+#define mutex_unlock(m) pthread_mutex_unlock(m)
+#define mutex_destroy(m) pthread_mutex_destroy(m)
+#endif
+
+int sim_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+static int64_t sim_now_ns(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER counter;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (int64_t)(counter.QuadPart * (1000000000.0 / freq.QuadPart));
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+/* Policies */
+static int is_safe(const GameState *state, int x, int y) {
+    if (cell_test(state, LAYER_BODY, y, x) || cell_test(state, LAYER_ENEMY, y, x)) return 0;
+    return !cell_test(state, LAYER_WALL, y, x) || state->score >= LEVEL_UPGRADE_SCORE;
+}
+
+enum direction sim_random_policy(GameState *state, Rng *rng, void *data) {
+    static const int dx[] = { 0, 0, -1, 1 };
+    static const int dy[] = { -1, 1, 0, 0 };
+    static const enum direction opposite[] = { DOWN, UP, RIGHT, LEFT };
+    SnakeSegment *head = snake_head(&state->snake);
+    enum direction current = state->dir;
+    (void)data;
+
+    // keep going most of the time so the snake actually travels
+    if (current != NONE && rng_range(rng, 8) != 0 && is_safe(state, head->x + dx[current], head->y + dy[current])) {
+        return current;
+    }
+    int start = rng_range(rng, 4);
+    for (int i = 0; i < 4; i++) {
+        enum direction dir = (enum direction)((start + i) & 3);
+        if (current != NONE && dir == opposite[current]) continue;
+        if (is_safe(state, head->x + dx[dir], head->y + dy[dir])) return dir;
+    }
+    return current == NONE ? (enum direction)start : current;
+}
+
+/* Workers */
+typedef struct SimRun SimRun;
+
+typedef struct {
+    Mutex lock;                  // Guards next and end, thieves take it too
+    long long next, end;         // Games [next, end) are still this worker's
+    SimRun *run;
+    int index;
+    int started;                 // state holds a game_init'd arena
+    GameState state;             // Reset for every game
+    long long games, ticks, cut_off, steals;
+    Histogram scores, survival;
+} Worker;
+
+struct SimRun {
+    const SimConfig *config;
+    Worker *workers;
+    int count;
+};
+
+void sim_config_default(SimConfig *config) {
+    memset(config, 0, sizeof(*config));
+    game_config_default(&config->config);
+    config->games = 1000;
+    config->max_ticks = SIM_DEFAULT_MAX_TICKS;
+}
+
+// the next game for this worker, stealing half of another worker's range when its own is empty.
+// -1 when every range is empty
+static long long next_game(Worker *worker) {
+    SimRun *run = worker->run;
+    long long game = -1;
+    mutex_lock(&worker->lock);
+    if (worker->next < worker->end) game = worker->next++;
+    mutex_unlock(&worker->lock);
+    if (game >= 0) return game;
+
+    for (int i = 1; i < run->count; i++) {
+        Worker *victim = &run->workers[(worker->index + i) % run->count];
+        long long first = 0, end = 0;
+        mutex_lock(&victim->lock);
+        long long left = victim->end - victim->next;
+        if (left > 0) {
+            // the back half: the victim keeps playing from the front, away from us
+            end = victim->end;
+            first = end - (left + 1) / 2;
+            victim->end = first;
+        }
+        mutex_unlock(&victim->lock);
+        if (end > first) {
+            worker->steals++;
+            mutex_lock(&worker->lock);
+            worker->next = first + 1;
+            worker->end = end;
+            mutex_unlock(&worker->lock);
+            return first;
+        }
+    }
+    return -1;
+}
+
+static void play_game(Worker *worker, long long game) {
+    const SimConfig *config = worker->run->config;
+    SimPolicy policy = config->policy ? config->policy : sim_random_policy;
+    GameConfig game_config = config->config;
+    game_config.seed = config->config.seed + (uint64_t)game;
+
+    GameState *state = &worker->state;
+    if (worker->started) {
+        game_reset(state, &game_config);
+    } else {
+        game_init(state, &game_config);
+        worker->started = 1;
+    }
+    Rng rng;
+    rng_seed(&rng, game_config.seed ^ 0xA5A5A5A5ULL);
+
+    long long ticks = 0;
+    while (!state->game_over && ticks < config->max_ticks) {
+        state->dir = policy(state, &rng, config->policy_data);
+        compute_game_state(state);
+        ticks++;
+    }
+    worker->games++;
+    worker->ticks += ticks;
+    if (!state->game_over) worker->cut_off++;
+    histogram_record(&worker->scores, state->score);
+    histogram_record(&worker->survival, ticks);
+}
+
+static void work(Worker *worker) {
+    long long game;
+    while ((game = next_game(worker)) >= 0) play_game(worker, game);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI worker_main(LPVOID arg) {
+    work(arg);
+    return 0;
+}
+#else
+static void *worker_main(void *arg) {
+    work(arg);
+    return NULL;
+}
+#endif
+
+void sim_run(const SimConfig *config, SimResult *result) {
+    SimRun run;
+    run.config = config;
+    run.count = config->threads > 0 ? config->threads : sim_cpu_count();
+    if (run.count > SIM_MAX_THREADS) run.count = SIM_MAX_THREADS;
+    if (config->games > 0 && run.count > config->games) run.count = (int)config->games;
+    if (run.count < 1) run.count = 1;
+    run.workers = game_alloc(sizeof(Worker) * (size_t)run.count);
+    memset(run.workers, 0, sizeof(Worker) * (size_t)run.count);
+
+    // deal the games out evenly, stealing evens out what the seeds don't
+    long long games = config->games > 0 ? config->games : 0;
+    for (int i = 0; i < run.count; i++) {
+        Worker *worker = &run.workers[i];
+        mutex_init(&worker->lock);
+        worker->run = &run;
+        worker->index = i;
+        worker->next = games * i / run.count;
+        worker->end = games * (i + 1) / run.count;
+    }
+
+    // the calling thread is worker 0
+    int64_t start = sim_now_ns();
+#ifdef _WIN32
+    HANDLE threads[SIM_MAX_THREADS];
+    for (int i = 1; i < run.count; i++) {
+        threads[i] = CreateThread(NULL, 0, worker_main, &run.workers[i], 0, NULL);
+        if (!threads[i]) die("CreateThread");
+    }
+    work(&run.workers[0]);
+    for (int i = 1; i < run.count; i++) {
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+    }
+#else
+    pthread_t threads[SIM_MAX_THREADS];
+    for (int i = 1; i < run.count; i++) {
+        if (pthread_create(&threads[i], NULL, worker_main, &run.workers[i])) die("pthread_create");
+    }
+    work(&run.workers[0]);
+    for (int i = 1; i < run.count; i++) pthread_join(threads[i], NULL);
+#endif
+    int64_t elapsed = sim_now_ns() - start;
+
+    memset(result, 0, sizeof(*result));
+    result->threads = run.count;
+    result->seconds = elapsed / 1e9;
+    for (int i = 0; i < run.count; i++) {
+        Worker *worker = &run.workers[i];
+        result->games += worker->games;
+        result->ticks += worker->ticks;
+        result->cut_off += worker->cut_off;
+        result->steals += worker->steals;
+        histogram_merge(&result->scores, &worker->scores);
+        histogram_merge(&result->survival, &worker->survival);
+        if (worker->started) game_free(&worker->state);
+        mutex_destroy(&worker->lock);
+    }
+    game_release(run.workers);
+}
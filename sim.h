@@ -0,0 +1,53 @@
+#ifndef SNAKE_SIM_H
+#define SNAKE_SIM_H
+
+/* Batch simulator: plays many independent games across a pool of threads,
+   with a policy choosing every move, and gathers score and survival
+   distributions. Each worker owns one GameState that it resets for every game,
+   so the run allocates nothing per game. Game i is seeded with seed + i and
+   games share nothing, so the results don't depend on the thread count.
+
+   Game lengths vary wildly, so the games are dealt out as index ranges, one
+   range per worker. A worker plays its own range from the front, and once it
+   is empty steals the back half of another worker's range. */
+
+#include "game.h"
+#include "stats.h"
+
+#define SIM_MAX_THREADS 256
+#define SIM_DEFAULT_MAX_TICKS 100000 // a policy that never dies would never finish
+
+// the move to make before the next tick, called once per tick
+typedef enum direction (*SimPolicy)(GameState *state, Rng *rng, void *data);
+
+typedef struct {
+    GameConfig config;           // Config of every game, config.seed seeds the first one
+    long long games;             // Games to play
+    int threads;                 // Workers, 0 for one per core
+    long long max_ticks;         // Games still running after this many ticks are cut off
+    SimPolicy policy;            // NULL for sim_random_policy
+    void *policy_data;           // Passed to the policy, shared by all workers
+} SimConfig;
+
+typedef struct {
+    long long games;             // Games played
+    long long ticks;             // Ticks over all games
+    long long cut_off;           // Games stopped by max_ticks
+    long long steals;            // Ranges taken from another worker
+    int threads;                 // Workers that ran
+    double seconds;              // Wall-clock time of the run
+    Histogram scores;            // Final score of each game
+    Histogram survival;          // Ticks each game lasted
+} SimResult;
+
+void sim_config_default(SimConfig *config);
+
+// random moves that keep going straight most of the time and avoid walls, the body and enemies
+enum direction sim_random_policy(GameState *state, Rng *rng, void *data);
+
+// online processors, at least 1
+int sim_cpu_count(void);
+
+void sim_run(const SimConfig *config, SimResult *result);
+
+#endif
@@ -3,99 +3,126 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
-#include <windows.h>
 #include <stdbool.h>
-
-#define CTRL_KEY(k) ((k) & 0x1F) 
-#define ESC "\x1b"
-
-#define GRID_ROWS 27
-#define GRID_COLS 120
-#define GRID_AREA (GRID_ROWS * GRID_COLS)
-
-#define SNAKE_HEAD_CHAR '0'
-#define SNAKE_BODY_CHAR 'o'
-#define ENEMY_CHAR '*'
-#define FOOD_CHAR '$'
-#define COLOR_RESET "\x1b[0m"
-#define COLOR_SNAKE "\x1b[33m" // yellow
-#define COLOR_FOOD "\x1b[32m" // green
-#define EMPTY_CHAR ' '
-#define WALL_CHAR '`'
-
-#define LEVEL_UPGRADE_SCORE 5 // score to unlock new power (wrap-around)
-
-//#define SLEEPING_TIME 60 // ms
-#define ENEMY_MOVE_INTERVAL 2 
-
-char screen_buffer[(GRID_COLS + 1) * GRID_ROWS + 1];
-
-enum direction {
-    UP = 0,
-    DOWN,
-    LEFT,
-    RIGHT
-};
-
-enum EditorKey {
-    ARROW_LEFT = 1000,
-    ARROW_RIGHT,
-    ARROW_UP,
-    ARROW_DOWN
-};
-
-/* Data structures */
-typedef struct {
-    DWORD orig_mode;    // Original console mode
-    HANDLE hStdin;      // Console input handle
-    HANDLE hStdout;     // Console output handle
-} TerminalConfig;
-
-typedef struct _SnakeSegment {
-    int x, y;                    // Position of the segment
-    struct _SnakeSegment *next;  // Pointer to the next segment
-} SnakeSegment;
-
-typedef struct {
-    int x, y;                    // Position of the enemy
-} Enemy;
-
-typedef struct {
-    SnakeSegment *head;        // Pointer to the head of the snake
-    Enemy *enemy;              // Pointer to the enemy
-    int food_x, food_y;        // Position of the food
-    int score;                 // Player's score
-    enum direction dir;        // Direction of the snake
-    int game_over;             // Game over flag
-    //int speed;                 // Speed of the snake
-    int enemy_move_counter;    // Counter for enemy movement
-} GameState;
+#include "game.h"
+#include "render.h"
+#include "presenter.h"
+#include "timestep.h"
+#include "input.h"
+#include "term.h"
+#include "stats.h"
+#include "replay.h"
+#include "history.h"
+#include "autopilot.h"
+#include "world.h"
+#include "swarm.h"
+#include "broadcast.h"
+#include "cast.h"
+#include "scores.h"
+
+#define KEY_BATCH 64 // keys decoded per read
+#define REWIND_HOLD_NS 500000000LL // a press of r rewinds this long, key repeat keeps it going while held
+#define LEADERBOARD_ROWS 10 // games --leaderboard lists
 
 /* Global state */
-TerminalConfig terminal_config;
 GameState game_state;
-int g_speed = 60; // default speed in milliseconds
-//int g_level = 1;  // default level
+Renderer renderer;
+Presenter presenter;      // Owns the renderer while the game runs
+Timestep timestep;
+TurnQueue turns;
+Stats stats;
+Stats *phase_stats;       // &stats with --stats, NULL leaves every timer off
+const char *stats_path;
+Recorder recorder;
+Recorder *recording;      // &recorder with --record
+Replay replay;
+Replay *replaying;        // &replay with --replay, the turns come from the file
+History history;
+History *rewinding;       // &history unless recording or replaying, which rewind would break
+int64_t rewind_until;     // clock reading the rewind key was last held for
+int rewind_too_big;       // the board's snapshots don't fit in HISTORY_BUDGET, rewind is off
+Autopilot autopilot;
+Autopilot *piloting;      // &autopilot with --autopilot, the turns come from the planner
+World world;
+World *roaming;           // &world with --world, played instead of game_state
+Swarm swarm;
+Swarm *swarming;          // &swarm with --rivals, played instead of game_state
+Broadcast broadcast;
+Broadcast *broadcasting;  // &broadcast with --broadcast, every frame also goes to the spectators
+Cast cast;
+Cast *casting;            // &cast with --cast, every frame is also written to the cast file
+const char *cast_path;
 
 /* Terminal config API */
 void clearScreen() {
-    DWORD written;
-    WriteConsole(terminal_config.hStdout, ESC "[2J", 4, &written, NULL);  // Clear screen
+    term_write(ESC "[2J", 4);  // Clear screen
 }
 
 void moveCursorToTopLeft() {
-    DWORD written;
-    WriteConsole(terminal_config.hStdout, ESC "[H", 3, &written, NULL);  // Move cursor to top-left
+    term_write(ESC "[H", 3);  // Move cursor to top-left
 }
 
 void hideCursor() {
-    DWORD written;
-    WriteConsole(terminal_config.hStdout, ESC "[?25l", 6, &written, NULL);  // Hide cursor
+    term_write(ESC "[?25l", 6);  // Hide cursor
 }
 
 void showCursor() {
-    DWORD written;
-    WriteConsole(terminal_config.hStdout, ESC "[?25h", 6, &written, NULL);  // Show cursor
+    term_write(ESC "[?25h", 6);  // Show cursor
+}
+
+/* Record and replay */
+// close the recording, whether the game ended or the player quit
+void finish_recording() {
+    if (!recording) return;
+    if (!recorder_close(recording, timestep.stats.ticks)) perror("record");
+    recording = NULL;
+}
+
+// one line on how the replay went
+int describe_replay(char *buf, size_t size, long long ticks) {
+    int len;
+    switch (replaying->status) {
+        case REPLAY_DIVERGED:
+            len = snprintf(buf, size, "Replay diverged from the recording at tick %lld\n", replaying->bad_tick);
+            break;
+        case REPLAY_CORRUPT:
+            len = snprintf(buf, size, "Replay file is damaged after tick %lld\n", replaying->bad_tick);
+            break;
+        default:
+            len = snprintf(buf, size, "Replay: %lld ticks, %lld checksums matched\n", ticks, replaying->checked);
+            break;
+    }
+    return len < (int)size ? len : (int)size - 1;
+}
+
+// --replay --headless: play the recording at full speed without a terminal
+int run_headless(GameState *state) {
+    char line[160];
+    game_init(state, &replaying->config);
+    state->stats = phase_stats;
+
+    long long ticks = 0;
+    int64_t start = term_now_ns();
+    while (!state->game_over && !replay_done(replaying, ticks)) {
+        enum direction turn = replay_turn(replaying, ticks);
+        if (turn != NONE) state->dir = turn;
+        compute_game_state(state);
+        ticks++;
+        replay_check(replaying, ticks, state);
+    }
+    int64_t elapsed = term_now_ns() - start;
+
+    printf("Score: %d%s\n", state->score, state->game_over ? ", game over" : "");
+    printf("Elapsed: %.3f ms, %.0f ticks/sec\n", elapsed / 1e6, elapsed > 0 ? ticks / (elapsed / 1e9) : 0);
+    describe_replay(line, sizeof(line), ticks);
+    fputs(line, stdout);
+    if (phase_stats) {
+        phase_stats->ticks = ticks;
+        if (!stats_write(phase_stats, stats_path)) printf("Could not write stats to %s\n", stats_path);
+    }
+    game_free(state);
+    replay_close(replaying);
+    return replaying->status == REPLAY_OK ? 0 : 1;
 }
 
 /* Terminal API */
@@ -106,552 +133,600 @@ void die(const char *s) {
     exit(1);
 }
 
-void disableRawMode() {
-    if (!SetConsoleMode(terminal_config.hStdin, terminal_config.orig_mode)) die("SetConsoleMode");
-}
-
-void enableRawMode() {
-    terminal_config.hStdin = GetStdHandle(STD_INPUT_HANDLE);
-    terminal_config.hStdout = GetStdHandle(STD_OUTPUT_HANDLE);
-
-    if (terminal_config.hStdin == INVALID_HANDLE_VALUE || terminal_config.hStdout == INVALID_HANDLE_VALUE)
-        die("GetStdHandle");
-
-    if (!GetConsoleMode(terminal_config.hStdin, &terminal_config.orig_mode)) die("GetConsoleMode");
-
-    atexit(disableRawMode);
-
-    DWORD mode = terminal_config.orig_mode;
-    mode &= ~(ENABLE_ECHO_INPUT | ENABLE_LINE_INPUT | ENABLE_PROCESSED_INPUT);
-    mode |= (ENABLE_WINDOW_INPUT | ENABLE_MOUSE_INPUT);
-    if (!SetConsoleMode(terminal_config.hStdin, mode)) die("SetConsoleMode (input)");
-
-    // enable ANSI escape sequences on the output
-    DWORD outMode = 0;
-    if (!GetConsoleMode(terminal_config.hStdout, &outMode)) die("GetConsoleMode (output)");
-    outMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
-    if (!SetConsoleMode(terminal_config.hStdout, outMode)) die("SetConsoleMode (output)");
-}
-
-// key events processing
-void process_key_events() {
-    INPUT_RECORD ir;
-    DWORD events;
-    DWORD read;
-
-    // check if there is input available
-    GetNumberOfConsoleInputEvents(terminal_config.hStdin, &events);
-    if (events == 0) return; // No input, exit immediately and continue the game
-
-    // if there is input, read it
-    if (!ReadConsoleInput(terminal_config.hStdin, &ir, 1, &read) || read != 1) return;
-
-    int c = -1; 
-
-    if (ir.EventType == KEY_EVENT && ir.Event.KeyEvent.bKeyDown) {
-        WORD vk = ir.Event.KeyEvent.wVirtualKeyCode;
-        CHAR ch = ir.Event.KeyEvent.uChar.AsciiChar;
+// apply one decoded key
+void process_key(int c) {
+    long long tick = timestep.stats.ticks;
+    enum direction heading = roaming ? roaming->dir : (swarming ? swarming->dir : game_state.dir);
+    switch (c) {
+        // the terminal was resized: whatever was on screen is gone
+        case KEY_RESIZE:
+            presenter_invalidate(&presenter);
+            break;
 
-        switch (vk) {
-            case VK_LEFT:  c = ARROW_LEFT; break;
-            case VK_UP:    c = ARROW_UP; break;
-            case VK_RIGHT: c = ARROW_RIGHT; break;
-            case VK_DOWN:  c = ARROW_DOWN; break;
-            default: c = ch; break;
-        }
-    }
+        // step back through the last ticks instead of playing them
+        case 'r':
+        case 'R':
+            if (rewinding) rewind_until = term_now_ns() + REWIND_HOLD_NS;
+            break;
 
-    switch (c) {
         case CTRL_KEY('q'):
+            finish_recording();
+            presenter_stop(&presenter);
+            if (broadcasting) broadcast_stop(broadcasting);
+            if (casting) cast_stop(casting);
             showCursor();
             clearScreen();
             moveCursorToTopLeft();
 			exit(0);
             break;
 
-        // update snake direction (prevent 180-degree turns)
+        // queue the turn, 180-degree turns are filtered against the last queued direction
         case ARROW_LEFT:
-            if (game_state.dir != RIGHT) game_state.dir = LEFT;
+            turn_queue_push(&turns, heading, LEFT, tick);
 			break;
         case ARROW_RIGHT:
-            if (game_state.dir != LEFT) game_state.dir = RIGHT;
+            turn_queue_push(&turns, heading, RIGHT, tick);
 			break;
         case ARROW_UP:
-            if (game_state.dir != DOWN) game_state.dir = UP;
+            turn_queue_push(&turns, heading, UP, tick);
 			break;
         case ARROW_DOWN:
-            if (game_state.dir != UP) game_state.dir = DOWN;
+            turn_queue_push(&turns, heading, DOWN, tick);
 			break;
     }
 }
 
-/* Game API */
-/* convert coordinates to index
-NOTE: this function has a wrap-around logic that is not
-utilised for the snake because hitting the walls cause death */
-int coordinates_to_index(int row, int col) {
-	if (row < 0) row = row + GRID_ROWS;
-	if (col < 0) col = col + GRID_COLS;
-	if (row >= GRID_ROWS) row = row % GRID_ROWS;
-	if (col >= GRID_COLS) col = col % GRID_COLS;
-	return col+GRID_COLS*row;
-}
-
-// set and get cell state in the grid
-void set_cell_state(char *grid, int row, int col, char state) {
-    int index = coordinates_to_index(row, col);
-    if (index >= 0 && index < GRID_AREA) {
-        grid[index] = state;
-    }
-}
-
-// get the state of a cell in the grid
-char get_cell_state(char *grid, int row, int col) {
-    int index = coordinates_to_index(row, col);
-    if (index >= 0 && index < GRID_AREA) {
-        return grid[index];
-    }
-    return EMPTY_CHAR;
-}
-
-// draw the game state to the console
-void draw_game(GameState *state) {
-    moveCursorToTopLeft();
-
-    DWORD written;
-
-    // increase buffer size to accommodate color codes. Each colored char can add ~10 bytes.
-    char temp_buffer[(GRID_AREA * 11) + 150]; 
-    char *p = temp_buffer;
-
-    // hide the cursor at the beginning of the draw cycle
-    p += sprintf(p, ESC "[?25l");
-
-    *p = '\n';
-    p++;
-
-    // iterate through each cell of the grid
-    for (int i = 0; i < GRID_ROWS; i++) {
-        for (int j = 0; j < GRID_COLS; j++) {
-            char cell = get_cell_state(screen_buffer, i, j);
-            switch (cell) {
-                case FOOD_CHAR:
-                    p += sprintf(p, "%s%c%s", COLOR_FOOD, FOOD_CHAR, COLOR_RESET);
-                    break;
-                case SNAKE_HEAD_CHAR:
-                case SNAKE_BODY_CHAR:
-                    p += sprintf(p, "%s%c%s", COLOR_SNAKE, cell, COLOR_RESET);
-                    break;
-                default:
-                    *p = cell; // any other character
-                    p++;
-                    break;
-            }
-        }
-        *p = '\n';
-        p++;
-    }
-
-    // add game info text
-    if (state->score >= LEVEL_UPGRADE_SCORE) {
-        p += sprintf(p, "New Power unlocked: Snake can now wrap around walls\n");
-    } else {
-        p += sprintf(p, "Use arrow keys to move the snake, eat the '$' before it gets eaten\n");
-    }
-    p += sprintf(p, "Score: %d\n", state->score);
-
-    // write the entire composed buffer to the console at once
-    WriteConsole(terminal_config.hStdout, temp_buffer, p - temp_buffer, &written, NULL);
-}
-
-// place food in a random empty cell
-void place_food(GameState *state) {
-    int x, y;
+// key events processing: drain everything pending, whichever backend decoded it
+void process_key_events() {
+    int keys[KEY_BATCH];
+    int count;
     do {
-        x = rand() % (GRID_COLS - 2) + 1;
-        y = rand() % (GRID_ROWS - 2) + 1;
-    } while (get_cell_state(screen_buffer, y, x) != EMPTY_CHAR && 
-             get_cell_state(screen_buffer, y, x) != SNAKE_BODY_CHAR && 
-             get_cell_state(screen_buffer, y, x) != SNAKE_HEAD_CHAR &&
-             get_cell_state(screen_buffer, y, x) != ENEMY_CHAR);
-
-    state->food_x = x;
-    state->food_y = y;
-    set_cell_state(screen_buffer, y, x, FOOD_CHAR);
+        count = term_read_keys(keys, KEY_BATCH);
+        for (int i = 0; i < count; i++) process_key(keys[i]);
+    } while (count == KEY_BATCH);
 }
 
-// place enemy in a random empty cell every 5 points scored
-void place_enemy(GameState *state) {
-    if (state->enemy != NULL) {
-        // set the previous enemy cell to empty (commenting this out to keep the enemy on the screen)
-        // set_cell_state(screen_buffer, state->enemy->y, state->enemy->x, EMPTY_CHAR); 
-        // NOTE: I should manage multiple enemies!!
-
-        // free the previous enemy
-        free(state->enemy); // free existing enemy
-    }
-    Enemy *enemy = malloc(sizeof(Enemy));
-    if (!enemy) die("malloc");
-    state->enemy = enemy;
-    // place enemy in a random empty cell (but opposite of the snake head)
-    do {
-        enemy->x = rand() % (GRID_COLS - 2) + 1;
-        enemy->y = rand() % (GRID_ROWS - 2) + 1;
-    } while (get_cell_state(screen_buffer, state->enemy->y, state->enemy->x) != EMPTY_CHAR && 
-             get_cell_state(screen_buffer, state->enemy->y, state->enemy->x) != SNAKE_BODY_CHAR && 
-             get_cell_state(screen_buffer, state->enemy->y, state->enemy->x) != SNAKE_HEAD_CHAR &&
-             get_cell_state(screen_buffer, state->enemy->y, state->enemy->x) != FOOD_CHAR &&
-             get_cell_state(screen_buffer, state->enemy->y, state->enemy->x) != ENEMY_CHAR );
-
-    // enemy->x == state->head->x ? enemy->x = state->head->x + GRID_COLS : enemy->x;
-    // enemy->y == state->head->y ? enemy->y = state->head->y + GRID_ROWS : enemy->y;
-    // 5 is the maximum min distance from the snake head
-    for (int i = -5; i <= 5; i++) {
-        if (enemy->x == state->head->x + i && enemy->y == state->head->y) {
-            enemy->x = (enemy->x + GRID_COLS - 1) % (GRID_COLS - 2) + 1; // wrap around horizontally
-        }
-        if (enemy->y == state->head->y + i && enemy->x == state->head->x) {
-            enemy->y = (enemy->y + GRID_ROWS - 1) % (GRID_ROWS - 2) + 1; // wrap around vertically
-        }
-    }
-    set_cell_state(screen_buffer, enemy->y, enemy->x, ENEMY_CHAR);
+// hand the game state to the render thread: a copy of the glyphs, never a wait on the console
+void draw_game(GameState *state) {
+    int64_t start = stats_begin(phase_stats);
+    Frame *frame = presenter_frame(&presenter);
+    game_render_glyphs(state, frame->glyphs);
+    frame->score = state->score;
+    if (broadcasting) broadcast_publish(broadcasting, frame->glyphs, frame->score);
+    if (casting) cast_publish(casting, frame->glyphs, frame->score);
+    presenter_publish(&presenter);
+    stats_end(phase_stats, PHASE_PUBLISH, start);
 }
 
-// initialize the snake at the center of the grid
-void init_snake(GameState *state) {
-    SnakeSegment *segment = malloc(sizeof(SnakeSegment));
-    if (!segment) die("malloc");
-    segment->x = GRID_COLS / 2;
-    segment->y = GRID_ROWS / 2;
-    segment->next = state->head;
-    state->head = segment;
-
-    set_cell_state(screen_buffer, segment->y, segment->x, SNAKE_HEAD_CHAR);
+// same for the huge world: only the camera's window is snapshotted
+void draw_world(World *world) {
+    int64_t start = stats_begin(phase_stats);
+    Frame *frame = presenter_frame(&presenter);
+    world_render_glyphs(world, frame->glyphs);
+    frame->score = world->score;
+    if (broadcasting) broadcast_publish(broadcasting, frame->glyphs, frame->score);
+    if (casting) cast_publish(casting, frame->glyphs, frame->score);
+    presenter_publish(&presenter);
+    stats_end(phase_stats, PHASE_PUBLISH, start);
 }
 
-// initialize the grid with walls and empty spaces
-void init_grid() {
-    for (int i = 0; i < GRID_ROWS; i++) {
-        for (int j = 0; j < GRID_COLS; j++) {
-            set_cell_state(screen_buffer, i, j, EMPTY_CHAR);
-            if (i == 0 || i == GRID_ROWS - 1 || j == 0 || j == GRID_COLS - 1) {
-                set_cell_state(screen_buffer, i, j, WALL_CHAR);
-            }
-        }
-    }
+// same for the rivals' board
+void draw_swarm(Swarm *swarm) {
+    int64_t start = stats_begin(phase_stats);
+    Frame *frame = presenter_frame(&presenter);
+    swarm_render_glyphs(swarm, frame->glyphs);
+    frame->score = swarm->score;
+    if (broadcasting) broadcast_publish(broadcasting, frame->glyphs, frame->score);
+    if (casting) cast_publish(casting, frame->glyphs, frame->score);
+    presenter_publish(&presenter);
+    stats_end(phase_stats, PHASE_PUBLISH, start);
 }
 
-// initialize the game state
-void init_game(GameState *state) {
+// initialize the terminal and the game state
+void init_game(GameState *state, GameConfig *config) {
     // init terminal
-    enableRawMode(); // has to be non-blocking
-    srand(time(NULL)); 
+    term_enable_raw_mode(); // has to be non-blocking
     hideCursor();
 
-    // draw board
-    init_grid();
-
-    // init the game state
-    state->head = NULL;
-    state->enemy = NULL;
-    state->food_x = -1;
-    state->food_y = -1;
-    state->score = 0;
-    state->dir = -1; // no initial direction
-    state->game_over = 0;
-    state->enemy_move_counter = 0;
-
-    init_snake(state);
-    place_food(state);
+    game_init(state, config);
 }
 
-void compute_enemy_position(GameState *state) {
-    if (!state->enemy || !state->head) {
-        return;
+void end_game(int score, int length, const GameConfig *config) {
+    char gameOverMsg[160];
+    int rank = 0;
+    finish_recording();
+    // the last frame is on screen before anything is written below it
+    presenter_stop(&presenter);
+    if (broadcasting) broadcast_stop(broadcasting);
+    int cast_ok = !casting || cast_stop(casting);
+    // add the game to the score journal (a replayed game already had its chance)
+    ScoreBoard board;
+    if (!replaying) {
+        if (scoreboard_open(&board, SCORES_JOURNAL)) {
+            ScoreRecord record = { score, length, config->speed, timestep.stats.ticks, config->seed, (int64_t)time(NULL) };
+            rank = scoreboard_add(&board, &record);
+            scoreboard_close(&board);
+        }
+        else rank = -1;
     }
-
-    // remove enemy from its current position
-    set_cell_state(screen_buffer, state->enemy->y, state->enemy->x, EMPTY_CHAR);
-
-    // target: food coordinates
-    int target_x = state->food_x;
-    int target_y = state->food_y;
-
-    // current enemy coordinates
-    int enemy_x = state->enemy->x;
-    int enemy_y = state->enemy->y;
-
-    // calculate distance with wrap-around logic
-    int dx = target_x - enemy_x;
-    int dy = target_y - enemy_y;
-
-    // playable area dimensions (excluding walls)
-    int playable_width = GRID_COLS - 2;
-    int playable_height = GRID_ROWS - 2;
-
-    // check if path across wall is shorter
-    // if distance is more than half the grid, it's better to wrap around
-    if (dx > playable_width / 2) {
-        dx = dx - playable_width; // go left instead
-    } else if (dx < -playable_width / 2) {
-        dx = dx + playable_width; // go right instead
+    // park the cursor below the HUD, delta frames may have left it anywhere
+    int len = sprintf(gameOverMsg, ESC "[%d;1H", renderer.hud_row + HUD_LINES);
+    term_write(gameOverMsg, len);
+    if (rank == 1) {
+        len = sprintf(gameOverMsg, "\n\n        GAME OVER! NEW HIGH SCORE: %d\n\n", score);
     }
-
-    if (dy > playable_height / 2) {
-        dy = dy - playable_height; // go up instead
-    } else if (dy < -playable_height / 2) {
-        dy = dy + playable_height; // go down instead
+    else if (rank > 1) {
+        len = sprintf(gameOverMsg, "\n\n        GAME OVER! Final Score: %d, #%d on the leaderboard\n\n", score, rank);
     }
-    // dx and dy now represent the shortest path direction
-
-    // movement logic
-    int next_x = enemy_x;
-    int next_y = enemy_y;
-
-    // determine priority move (horizontal or vertical)
-    if (abs(dx) > abs(dy)) {
-        next_x += (dx > 0) ? 1 : -1; // move horizontally
-    } else if (abs(dy) > 0) {
-        next_y += (dy > 0) ? 1 : -1; // move vertically
+    else {
+        len = sprintf(gameOverMsg, "\n\n        GAME OVER! Final Score: %d\n\n", score);
+    }
+    term_write(gameOverMsg, len);
+    if (rank < 0) {
+        len = sprintf(gameOverMsg, "Could not save the score to %s\n\n", SCORES_JOURNAL);
+        term_write(gameOverMsg, len);
     }
 
-    // handle physical wrap-around
-    // if enemy hits a wall, it appears on the opposite side
-    if (next_x == 0) next_x = GRID_COLS - 2;
-    else if (next_x == GRID_COLS - 1) next_x = 1;
-    
-    if (next_y == 0) next_y = GRID_ROWS - 2;
-    else if (next_y == GRID_ROWS - 1) next_y = 1;
-
-    // check if priority move is blocked by an obstacle (snake body)
-    char cell_content = get_cell_state(screen_buffer, next_y, next_x);
-    if (cell_content == SNAKE_BODY_CHAR) {
-        // priority move is blocked, try secondary move
-        next_x = enemy_x; // reset move
-        next_y = enemy_y;
-
-        if (abs(dy) > 0 && abs(dx) <= abs(dy)) { // try vertical movement if it wasn't the priority
-            next_y += (dy > 0) ? 1 : -1;
-        } else if (abs(dx) > 0) { // otherwise try horizontal
-            next_x += (dx > 0) ? 1 : -1;
-        }
-
-        // apply wrap-around to secondary move too
-        if (next_x == 0) next_x = GRID_COLS - 2;
-        else if (next_x == GRID_COLS - 1) next_x = 1;
-        if (next_y == 0) next_y = GRID_ROWS - 2;
-        else if (next_y == GRID_ROWS - 1) next_y = 1;
-        
-        // check if secondary move is also blocked
-        cell_content = get_cell_state(screen_buffer, next_y, next_x);
-        if (cell_content == SNAKE_BODY_CHAR) {
-            next_x = enemy_x; // secondary move is also blocked, enemy stays still
-            next_y = enemy_y;
+    // how well the loop kept its schedule
+    TickStats *stats = &timestep.stats;
+    double period = stats->ticks > 1 ? (double)(stats->last - stats->start) / (stats->ticks - 1) : 0;
+    len = sprintf(gameOverMsg, "Ticks: %lld, mean period %.2f ms, late by %.3f ms on average (stddev %.3f, max %.3f)\n",
+                  stats->ticks, period / 1e6, timestep_jitter_mean(stats) / 1e6,
+                  timestep_jitter_stddev(stats) / 1e6, stats->late_max / 1e6);
+    term_write(gameOverMsg, len);
+    len = sprintf(gameOverMsg, "Frames: %lld drawn, %lld replaced by a newer one first, %lld skipped, %lld ticks dropped\n",
+                  presenter.drawn, presenter.replaced, stats->skipped_frames, stats->dropped_ticks);
+    term_write(gameOverMsg, len);
+    // ticks between reading a key and the snake turning, 0 is the very next tick
+    len = sprintf(gameOverMsg, "Turns: %lld, input latency p50 %d p99 %d max %d ticks, %lld dropped\n\n",
+                  turns.applied, turn_latency_percentile(&turns, 50), turn_latency_percentile(&turns, 99),
+                  turn_latency_percentile(&turns, 100), turns.dropped);
+    term_write(gameOverMsg, len);
+    if (rewind_too_big) {
+        len = sprintf(gameOverMsg, "Rewind: off, a %.1f MB snapshot per tick is too much for this board\n\n",
+                      game_state.snapshot_bytes / 1048576.0);
+        term_write(gameOverMsg, len);
+    }
+    if (replaying) {
+        len = describe_replay(gameOverMsg, sizeof(gameOverMsg), stats->ticks);
+        term_write(gameOverMsg, len);
+    }
+    if (broadcasting) {
+        len = sprintf(gameOverMsg, "Broadcast: %lld frames to %d spectators at most, %lld keyframes, %lld times a spectator fell behind\n\n",
+                      broadcasting->composed, broadcasting->peak_spectators, broadcasting->keyframes, broadcasting->lapped);
+        term_write(gameOverMsg, len);
+    }
+    if (casting) {
+        if (cast_ok) {
+            len = snprintf(gameOverMsg, sizeof(gameOverMsg), "Cast: %lld frames to %s, %lld dropped while the writer was behind\n\n",
+                           casting->written, cast_path, casting->dropped);
+        } else {
+            len = snprintf(gameOverMsg, sizeof(gameOverMsg), "Cast: could not write %s\n\n", cast_path);
         }
+        term_write(gameOverMsg, len < (int)sizeof(gameOverMsg) ? len : (int)sizeof(gameOverMsg) - 1);
     }
-
-    // check if enemy reached the food
-    if (next_x == state->food_x && next_y == state->food_y) {
-        place_food(state); // enemy 'eats' the food, reposition it
+    if (roaming) {
+        len = sprintf(gameOverMsg, "World: %dx%d, %d chunks in use, %zu KB held\n\n",
+                      roaming->rows, roaming->cols, roaming->chunks, world_memory(roaming) / 1024);
+        term_write(gameOverMsg, len);
     }
-
-    // game over condition is collision with snake head
-    if (next_x == state->head->x && next_y == state->head->y) {
-        state->game_over = 1;
-        set_cell_state(screen_buffer, next_y, next_x, ENEMY_CHAR);
-        return;
+    if (swarming) {
+        len = sprintf(gameOverMsg, "Rivals: %d on the board, %lld died, %lld segments at the end\n\n",
+                      swarming->snake_count - 1, swarming->deaths, swarming->segments);
+        term_write(gameOverMsg, len);
     }
 
-    // update enemy coordinates
-    state->enemy->x = next_x;
-    state->enemy->y = next_y;
-
-    // draw enemy at new position
-    set_cell_state(screen_buffer, state->enemy->y, state->enemy->x, ENEMY_CHAR);
-}
-
-// compute the new position of the snake based on its direction
-void compute_snake_position(GameState *state) {
-    // waiting for the first input
-    if (state->dir == -1) {
-        return;
-    }
-    // new head segment
-    SnakeSegment *new_head = malloc(sizeof(SnakeSegment));
-    if (!new_head) die("malloc");
-
-    // new head position based on current direction
-    new_head->x = state->head->x;
-    new_head->y = state->head->y;
-    switch (state->dir) {
-        case UP:    new_head->y--; break;
-        case DOWN:  new_head->y++; break;
-        case LEFT:  new_head->x--; break;
-        case RIGHT: new_head->x++; break;
-    }
-
-    // handle physical wrap-around
-    // if snake hits a wall, it appears on the opposite side
-    if (state->score >= LEVEL_UPGRADE_SCORE) { // if score is high enough, allow wrap-around
-        if (new_head->x == 0) new_head->x = GRID_COLS - 2;
-        else if (new_head->x == GRID_COLS - 1) new_head->x = 1;
-
-        if (new_head->y == 0) new_head->y = GRID_ROWS - 2;
-        else if (new_head->y == GRID_ROWS - 1) new_head->y = 1;
-    }
-
-    // check for collisions
-    char cell_content = get_cell_state(screen_buffer, new_head->y, new_head->x);
-    // if score < 20 we don't allow the snake to go through walls
-    if (cell_content == WALL_CHAR && state->score < LEVEL_UPGRADE_SCORE) {
-        state->game_over = 1;
-        free(new_head);
-        return;
-    }
-    if (cell_content == SNAKE_BODY_CHAR || cell_content == ENEMY_CHAR) {
-        state->game_over = 1;
-        free(new_head);
-        return;
-    }
-
-    // update the new head position
-    new_head->next = state->head;
-    state->head = new_head;
-
-    // update the screen buffer
-    set_cell_state(screen_buffer, state->head->y, state->head->x, SNAKE_HEAD_CHAR);
-    if (state->head->next) {
-        set_cell_state(screen_buffer, state->head->next->y, state->head->next->x, SNAKE_BODY_CHAR);
-    }
-
-    // check if the snake has eaten
-    if (new_head->x == state->food_x && new_head->y == state->food_y) {
-        state->score++;
-        place_food(state); // snake grows (we don't remove the tail)
-        // place an enemy
-        if (state->score % 1 == 0) { // adding anemies and increasing speed every 1 point (seems more for fun)
-            place_enemy(state);
-            g_speed > 0 ? g_speed-- : 1;
-            //g_level++;
-        }
-    } else {
-        // if it hasn't eaten, remove the tail segment
-        SnakeSegment *tail = state->head;
-        SnakeSegment *prev = NULL;
-        while (tail->next != NULL) {
-            prev = tail;
-            tail = tail->next;
-        }
-        // remove the tail segment from the screen buffer
-        if (prev) {
-            prev->next = NULL;
-            set_cell_state(screen_buffer, tail->y, tail->x, EMPTY_CHAR);
-            free(tail);
+    if (phase_stats) {
+        phase_stats->ticks = stats->ticks;
+        if (!stats_write(phase_stats, stats_path)) {
+            len = snprintf(gameOverMsg, sizeof(gameOverMsg), "Could not write stats to %s\n\n", stats_path);
+            term_write(gameOverMsg, len < (int)sizeof(gameOverMsg) ? len : (int)sizeof(gameOverMsg) - 1);
         }
     }
+    showCursor();
 }
 
-void compute_game_state(GameState *state) {
-    // snake move always
-    compute_snake_position(state);
-    if (state->game_over) return;
-
-    // enemy moves only if the counter reaches the interval
-    if (state->enemy) {
-        state->enemy_move_counter++;
-
-        if (state->enemy_move_counter >= ENEMY_MOVE_INTERVAL) {
-            compute_enemy_position(state);
-            state->enemy_move_counter = 0;
+// --world: the same loop on a chunked world seen through a board-sized camera; no
+// rewind, recording or autopilot, which all work on a GameState
+int run_world(const GameConfig *config, int view_rows, int view_cols, int fps) {
+    world_init(&world, config, view_rows, view_cols);
+    world.stats = phase_stats;
+    roaming = &world;
+
+    timestep_init(&timestep, term_now_ns(), world.speed * 1000000LL, fps);
+    draw_world(&world);
+    while (!world.game_over) {
+        int64_t start = stats_begin(phase_stats);
+        process_key_events();
+        stats_end(phase_stats, PHASE_INPUT, start);
+        int ticks = timestep_advance(&timestep, term_now_ns());
+        for (int i = 0; i < ticks && !world.game_over; i++) {
+            enum direction turn = turn_queue_pop(&turns, timestep.stats.ticks);
+            if (turn != NONE) world.dir = turn;
+            world_tick(&world);
+            timestep_tick_done(&timestep);
+            timestep_set_period(&timestep, world.speed * 1000000LL);
+        }
+        if (timestep_frame_due(&timestep) || world.game_over) {
+            draw_world(&world);
+            timestep_frame_done(&timestep);
         }
+        if (phase_stats && phase_stats->clock() - start > timestep.tick_ns) phase_stats->overruns++;
+        term_wait(timestep_wait(&timestep));
     }
-    
-    if (state->game_over) return;
+    end_game(world.score, world.snake.length, config);
+    world_free(&world);
+    renderer_free(&renderer);
+    return 0;
 }
 
-void end_game(GameState *state) {
-    char gameOverMsg[100];
-    DWORD written;
-    boolean new_high_score = false;
-    // read score from file, if it's higher than the current score, save it
-    FILE *file = fopen("snake_score.txt", "r");
-    if (file) {
-        int high_score;
-        fscanf(file, "Final Score: %d\n", &high_score);
-        if (high_score < game_state.score) {
-            new_high_score = true;
-            // save the new high score
-            fclose(file);
-            file = fopen("snake_score.txt", "w");
-            if (!file) die("fopen");
-            fprintf(file, "Final Score: %d\n", game_state.score);
-        }
-        fclose(file);
-    }
-    else {
-        // if file doesn't exist, create it
-        file = fopen("snake_score.txt", "w");
-        if (!file) die("fopen");
-        fprintf(file, "Final Score: %d\n", game_state.score);
-        new_high_score = true;
-        fclose(file);
+// --leaderboard: the best games in the score journal
+int print_leaderboard(void) {
+    ScoreBoard board;
+    ScoreRecord top[LEADERBOARD_ROWS];
+    if (!scoreboard_open(&board, SCORES_JOURNAL)) {
+        printf("Cannot open %s\n", SCORES_JOURNAL);
+        return 1;
     }
-    int len = 0;
-    if (new_high_score) {
-        len = sprintf(gameOverMsg, "\n\n        GAME OVER! NEW HIGH SCORE: %d\n\n", game_state.score);
+    int count = scoreboard_top(&board, top, LEADERBOARD_ROWS);
+    scoreboard_close(&board);
+    if (!count) {
+        printf("No games recorded yet\n");
+        return 0;
     }
-    else {
-        len = sprintf(gameOverMsg, "\n\n        GAME OVER! Final Score: %d\n\n", game_state.score);
+    printf("Rank  Score  Length     Ticks  Speed                 Seed  Date\n");
+    for (int i = 0; i < count; i++) {
+        char date[32] = "?";
+        time_t when = (time_t)top[i].time;
+        struct tm *local = localtime(&when);
+        if (local) strftime(date, sizeof(date), "%Y-%m-%d %H:%M", local);
+        printf("%4d  %5d  %6d  %8lld  %5d  %19llu  %s\n", i + 1, top[i].score, top[i].length,
+               (long long)top[i].ticks, top[i].speed, (unsigned long long)top[i].seed, date);
     }
-    WriteConsole(terminal_config.hStdout, gameOverMsg, len, &written, NULL);
-    showCursor();
+    return 0;
 }
 
-void free_snake(SnakeSegment *head) {
-    SnakeSegment *current = head;
-    SnakeSegment *next;
-    while (current != NULL) {
-        next = current->next;
-        free(current);
-        current = next;
+// --rivals: the same loop on a board shared with AI snakes; no rewind, recording or
+// autopilot, which all work on a GameState
+int run_swarm(const GameConfig *config, int rivals, int fps) {
+    swarm_init(&swarm, config, rivals);
+    swarm.stats = phase_stats;
+    swarming = &swarm;
+
+    timestep_init(&timestep, term_now_ns(), swarm.speed * 1000000LL, fps);
+    draw_swarm(&swarm);
+    while (!swarm.game_over) {
+        int64_t start = stats_begin(phase_stats);
+        process_key_events();
+        stats_end(phase_stats, PHASE_INPUT, start);
+        int ticks = timestep_advance(&timestep, term_now_ns());
+        for (int i = 0; i < ticks && !swarm.game_over; i++) {
+            enum direction turn = turn_queue_pop(&turns, timestep.stats.ticks);
+            if (turn != NONE) swarm.dir = turn;
+            swarm_tick(&swarm);
+            timestep_tick_done(&timestep);
+            timestep_set_period(&timestep, swarm.speed * 1000000LL);
+        }
+        if (timestep_frame_due(&timestep) || swarm.game_over) {
+            draw_swarm(&swarm);
+            timestep_frame_done(&timestep);
+        }
+        if (phase_stats && phase_stats->clock() - start > timestep.tick_ns) phase_stats->overruns++;
+        term_wait(timestep_wait(&timestep));
     }
+    // the player's body is gone with the player, it was one segment longer than the score
+    end_game(swarm.score, swarm.score + 1, config);
+    swarm_free(&swarm);
+    renderer_free(&renderer);
+    return 0;
 }
 
 int main(int argc, char *argv[]) {
+    GameConfig config;
+    game_config_default(&config);
+    int full_redraw = 0;
+    int fps = DEFAULT_FPS;
+    int headless = 0;
+    const char *record_path = NULL;
+    int pilot = 0;
+    int pilot_budget = AUTOPILOT_DEFAULT_BUDGET;
+    int world_rows = 0, world_cols = 0;
+    const char *broadcast_path = NULL;
+    int rivals = 0;
+    config.rows = config.cols = 0; // fit the terminal unless given
     for (int i = 1; i < argc; i++) {
         // read -speed value (i.e --speed 100)
         if (!strcmp(argv[i], "--speed") && i + 1 < argc) {
             int speed = atoi(argv[++i]);
             //printf("Setting speed to %d ms\n", speed);
             if (speed > 0) {
-                g_speed = speed;
+                config.speed = speed;
             } else {
                 printf("Invalid speed value: %s\n", argv[i]);
             }
         }
+        // --max-enemies caps how many enemies can be on the board at once
+        else if (!strcmp(argv[i], "--max-enemies") && i + 1 < argc) {
+            int max_enemies = atoi(argv[++i]);
+            if (max_enemies >= 0) {
+                config.max_enemies = max_enemies;
+            } else {
+                printf("Invalid enemy count: %s\n", argv[i]);
+            }
+        }
+        // --rows and --cols size the board, walls included
+        else if ((!strcmp(argv[i], "--rows") || !strcmp(argv[i], "--cols")) && i + 1 < argc) {
+            int rows = !strcmp(argv[i], "--rows");
+            int value = atoi(argv[++i]);
+            if (value >= (rows ? MIN_GRID_ROWS : MIN_GRID_COLS)) {
+                if (rows) config.rows = value;
+                else config.cols = value;
+            } else {
+                printf("Invalid board size: %s (at least %d rows and %d columns)\n", argv[i], MIN_GRID_ROWS, MIN_GRID_COLS);
+            }
+        }
+        // --fps caps how often the screen is redrawn, the simulation keeps its own rate
+        else if (!strcmp(argv[i], "--fps") && i + 1 < argc) {
+            int value = atoi(argv[++i]);
+            if (value >= 0) {
+                fps = value;
+            } else {
+                printf("Invalid frame rate: %s\n", argv[i]);
+            }
+        }
+        // --full-redraw repaints the whole grid every frame instead of only the changes
+        else if (!strcmp(argv[i], "--full-redraw")) {
+            full_redraw = 1;
+        }
+        // --stats times every phase of the loop and writes the histograms to a file at the end
+        else if (!strcmp(argv[i], "--stats") && i + 1 < argc) {
+            stats_path = argv[++i];
+        }
+        // --record writes the seed and every turn to a file, --replay plays one back
+        else if (!strcmp(argv[i], "--record") && i + 1 < argc) {
+            record_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--replay") && i + 1 < argc) {
+            if (!replay_open(&replay, argv[++i])) {
+                printf("Not a recording: %s\n", argv[i]);
+                return 1;
+            }
+            replaying = &replay;
+        }
+        // --headless replays as fast as possible and only prints the outcome
+        else if (!strcmp(argv[i], "--headless")) {
+            headless = 1;
+        }
+        // --autopilot lets the built-in planner steer, --autopilot-budget caps its work per tick
+        else if (!strcmp(argv[i], "--autopilot")) {
+            pilot = 1;
+        }
+        else if (!strcmp(argv[i], "--autopilot-budget") && i + 1 < argc) {
+            int value = atoi(argv[++i]);
+            if (value > 0) {
+                pilot_budget = value;
+            } else {
+                printf("Invalid autopilot budget: %s\n", argv[i]);
+            }
+        }
+        // --world <n> or <rows>x<cols> plays on a huge world, the board becomes its camera
+        else if (!strcmp(argv[i], "--world") && i + 1 < argc) {
+            int rows, cols;
+            int fields = sscanf(argv[++i], "%dx%d", &rows, &cols);
+            if (fields == 1) cols = rows;
+            if (fields >= 1 && rows >= MIN_GRID_ROWS && cols >= MIN_GRID_COLS) {
+                world_rows = rows;
+                world_cols = cols;
+            } else {
+                printf("Invalid world size: %s (<n> or <rows>x<cols>)\n", argv[i]);
+            }
+        }
+        // --rivals <n> shares the board with n AI snakes
+        else if (!strcmp(argv[i], "--rivals") && i + 1 < argc) {
+            int value = atoi(argv[++i]);
+            if (value > 0 && value <= SWARM_MAX_RIVALS) {
+                rivals = value;
+            } else {
+                printf("Invalid rival count: %s (1 to %d)\n", argv[i], SWARM_MAX_RIVALS);
+            }
+        }
+        // --cast records the session as an asciicast
+        else if (!strcmp(argv[i], "--cast") && i + 1 < argc) {
+            cast_path = argv[++i];
+        }
+        // --broadcast streams the game to spectators, --watch is the spectator
+        else if (!strcmp(argv[i], "--broadcast") && i + 1 < argc) {
+            broadcast_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--watch") && i + 1 < argc) {
+            const char *path = argv[++i];
+            if (!broadcast_watch(path)) {
+                printf("Cannot watch %s: %s\n", path, strerror(errno));
+                return 1;
+            }
+            return 0;
+        }
+        else if (!strcmp(argv[i], "--leaderboard")) {
+            return print_leaderboard();
+        }
         // --help
         else if (!strcmp(argv[i], "--help")) {
-            printf("Usage: snake [--speed <milliseconds>]\n");
+            printf("Usage: snake [--speed <milliseconds>] [--max-enemies <n>] [--rows <n>] [--cols <n>] [--fps <n>] [--full-redraw] [--stats <file>] [--autopilot [--autopilot-budget <n>]] [--record <file> | --replay <file> [--headless]] [--world <size> | --rivals <n>] [--broadcast <socket> | --watch <socket>] [--cast <file>] [--leaderboard]\n");
             printf("Options:\n");
             printf("  --speed <milliseconds>  Set the speed of the snake (default is 60 ms)\n");
+            printf("  --max-enemies <n>       Maximum number of enemies on the board (default is %d)\n", DEFAULT_MAX_ENEMIES);
+            printf("  --rows <n>, --cols <n>  Board size including the walls (default is the terminal size)\n");
+            printf("  --fps <n>               Maximum frames drawn per second, 0 for every tick (default is %d)\n", DEFAULT_FPS);
+            printf("  --full-redraw           Repaint the whole screen every frame (default is changed cells only)\n");
+            printf("  --stats <file>          Write per-phase timings at game over, JSON if the name ends in .json, CSV otherwise\n");
+            printf("  --autopilot             Let the built-in planner steer the snake\n");
+            printf("  --autopilot-budget <n>  Cells the planner may visit per tick (default is %d)\n", AUTOPILOT_DEFAULT_BUDGET);
+            printf("  --record <file>         Record the seed and every turn so the game can be replayed\n");
+            printf("  --replay <file>         Play a recorded game back, checking it against the recorded checksums\n");
+            printf("  --headless              With --replay, replay as fast as possible without drawing\n");
+            printf("  --world <size>          Play on a huge world, <n> or <rows>x<cols> cells, seen through a board-sized camera\n");
+            printf("  --rivals <n>            Share the board with n AI snakes (at most %d, and one per %d cells)\n", SWARM_MAX_RIVALS, SWARM_CELLS_PER_RIVAL);
+            printf("  --broadcast <socket>    Stream the game to spectators on a Unix socket (Linux)\n");
+            printf("  --watch <socket>        Watch a game streamed with --broadcast, Ctrl-Q to stop\n");
+            printf("  --cast <file>           Record the session as an asciicast v2 file, written on a thread of its own\n");
+            printf("  --leaderboard           Show the best %d games from %s\n", LEADERBOARD_ROWS, SCORES_JOURNAL);
+            printf("Keys: arrows to steer, hold r to rewind the last %d seconds, Ctrl-Q to quit\n", HISTORY_SECONDS);
             return 0;
         } else {
             printf("Unknown option: %s\n", argv[i]);
             return 1;
         }
     }
+    if (pilot && replaying) {
+        printf("--autopilot and --replay both steer the snake, pick one\n");
+        return 1;
+    }
+    if (world_rows && (pilot || replaying || record_path)) {
+        printf("--world plays on its own board: no --autopilot, --record or --replay\n");
+        return 1;
+    }
+    if (rivals && (world_rows || pilot || replaying || record_path)) {
+        printf("--rivals plays on its own board: no --world, --autopilot, --record or --replay\n");
+        return 1;
+    }
+    if (headless && !replaying) {
+        printf("--headless needs --replay <file>\n");
+        return 1;
+    }
+    if (stats_path) {
+        stats_init(&stats, term_now_ns);
+        phase_stats = &stats;
+    }
+    if (headless) return run_headless(&game_state);
+
+    // fill the terminal: the blank first line and the HUD take the rest, and the cursor
+    // must not reach the last line or the terminal would scroll
+    int term_rows, term_cols;
+    if (!term_size(&term_rows, &term_cols)) {
+        term_rows = DEFAULT_GRID_ROWS + GRID_SCREEN_ROW + HUD_LINES;
+        term_cols = DEFAULT_GRID_COLS;
+    }
+    if (!config.rows) config.rows = term_rows - GRID_SCREEN_ROW - HUD_LINES;
+    if (!config.cols) config.cols = term_cols;
+    if (config.rows < MIN_GRID_ROWS) config.rows = MIN_GRID_ROWS;
+    if (config.cols < MIN_GRID_COLS) config.cols = MIN_GRID_COLS;
+    // a replay is the recorded game, whatever the options and the terminal say
+    if (replaying) config = replaying->config;
+    else config.seed = (uint64_t)time(NULL);
+    if (record_path) {
+        if (!recorder_open(&recorder, record_path, &config)) {
+            printf("Cannot create recording: %s\n", record_path);
+            return 1;
+        }
+        recording = &recorder;
+    }
 
-    init_game(&game_state);
+    renderer_init(&renderer, full_redraw, config.rows, config.cols);
+    if (broadcast_path) {
+        if (!broadcast_start(&broadcast, broadcast_path, config.rows, config.cols)) {
+            printf("Cannot broadcast on %s: %s\n", broadcast_path, strerror(errno));
+            return 1;
+        }
+        broadcasting = &broadcast;
+    }
+    if (cast_path) {
+        if (!cast_start(&cast, cast_path, config.rows, config.cols)) {
+            printf("Cannot create cast: %s: %s\n", cast_path, strerror(errno));
+            return 1;
+        }
+        casting = &cast;
+    }
+    presenter_start(&presenter, &renderer, phase_stats);
+    turn_queue_init(&turns);
+    if (world_rows) {
+        term_enable_raw_mode(); // has to be non-blocking
+        hideCursor();
+        // the world is at least as big as the camera
+        config.rows = world_rows > config.rows ? world_rows : config.rows;
+        config.cols = world_cols > config.cols ? world_cols : config.cols;
+        return run_world(&config, renderer.rows, renderer.cols, fps);
+    }
+    if (rivals) {
+        term_enable_raw_mode(); // has to be non-blocking
+        hideCursor();
+        return run_swarm(&config, rivals, fps);
+    }
+    init_game(&game_state, &config);
+    game_state.stats = phase_stats;
+    if (!recording && !replaying) {
+        int capacity = history_capacity(&game_state, HISTORY_SECONDS * 1000 / (game_state.speed > 0 ? game_state.speed : 1));
+        if (capacity) {
+            history_init(&history, &game_state, capacity);
+            rewinding = &history;
+        }
+        else rewind_too_big = 1;
+    }
+    if (pilot) {
+        autopilot_init(&autopilot, &game_state, pilot_budget);
+        piloting = &autopilot;
+    }
 
-    // game loop
-    while (!game_state.game_over) {
+    // game loop: ticks run on a fixed schedule, frames are drawn when the frame rate allows
+    // and the loop sleeps until whichever comes next
+    timestep_init(&timestep, term_now_ns(), game_state.speed * 1000000LL, fps);
+    draw_game(&game_state);
+    while (!game_state.game_over && !(replaying && replay_done(replaying, timestep.stats.ticks))) {
+        int64_t start = stats_begin(phase_stats);
         process_key_events();
-        compute_game_state(&game_state);
-        draw_game(&game_state);
-        Sleep(g_speed);
+        stats_end(phase_stats, PHASE_INPUT, start);
+        int ticks = timestep_advance(&timestep, term_now_ns());
+        for (int i = 0; i < ticks && !game_state.game_over; i++) {
+            long long tick = timestep.stats.ticks;
+            if (rewinding && timestep.now < rewind_until) {
+                // one snapshot back per tick; with none left the game waits
+                if (history_pop(rewinding, &game_state)) {
+                    turn_queue_clear(&turns);
+                    if (piloting) autopilot_reset(piloting);
+                }
+                timestep_tick_done(&timestep);
+                timestep_set_period(&timestep, game_state.speed * 1000000LL);
+                continue;
+            }
+            if (rewinding) history_push(rewinding, &game_state);
+            enum direction turn;
+            if (replaying) {
+                turn = replay_turn(replaying, tick);
+            } else if (piloting) {
+                int64_t plan_start = stats_begin(phase_stats);
+                turn = autopilot_next(piloting, &game_state);
+                stats_end(phase_stats, PHASE_PLAN, plan_start);
+                if (turn == game_state.dir) turn = NONE; // only real turns are recorded
+            } else {
+                turn = turn_queue_pop(&turns, tick);
+            }
+            if (turn != NONE) {
+                game_state.dir = turn;
+                if (recording) recorder_turn(recording, tick, turn);
+            }
+            compute_game_state(&game_state);
+            timestep_tick_done(&timestep);
+            if (recording) recorder_tick_done(recording, timestep.stats.ticks, &game_state);
+            if (replaying && (!replay_check(replaying, timestep.stats.ticks, &game_state) ||
+                              replay_done(replaying, timestep.stats.ticks))) break;
+            // eating speeds the game up
+            timestep_set_period(&timestep, game_state.speed * 1000000LL);
+        }
+        if (timestep_frame_due(&timestep) || game_state.game_over || (replaying && replay_done(replaying, timestep.stats.ticks))) {
+            draw_game(&game_state);
+            timestep_frame_done(&timestep);
+        }
+        // the loop overran when its work alone took longer than a tick
+        if (phase_stats && phase_stats->clock() - start > timestep.tick_ns) phase_stats->overruns++;
+        term_wait(timestep_wait(&timestep));
+    }
+    end_game(game_state.score, game_state.snake.length, &config);
+    game_free(&game_state);
+    renderer_free(&renderer);
+    if (rewinding) history_free(rewinding);
+    if (piloting) autopilot_free(piloting);
+    if (replaying) {
+        replay_close(replaying);
+        return replaying->status == REPLAY_OK ? 0 : 1;
     }
-    end_game(&game_state);
-    free_snake(game_state.head);
-    free(game_state.enemy);
     return 0;
 }
\ No newline at end of file
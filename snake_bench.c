@@ -0,0 +1,1113 @@
+/* Headless benchmark for the simulation core.
+   Runs the game with scripted or random input, with no rendering and no
+   sleeping, and reports throughput, per-tick latency percentiles and how
+   many allocations the core makes per tick.
+   With --compose it measures the frame composer instead: bytes per frame and
+   compose time of the original sprintf renderer against render.c.
+   With --enemies it measures the batched enemy update as the pool grows.
+   With --flow it compares a full rebuild of the enemies' flow field against an
+   incremental update, on the game board and on much larger grids.
+   With --queries it compares the occupancy queries on the layer bitboards
+   against scanning the derived glyphs cell by cell.
+   With --snapshots it measures taking and restoring a game-state snapshot as
+   the snake grows, against deep-copying a malloc'd list of segments.
+   With --sim it plays whole games on the batch simulator with 1, 2, 4, ...
+   threads up to the core count and reports the scaling.
+   With --env it steps a batch of environments with random actions through
+   the training API, observations included.
+   With --autopilot it plays games with the built-in planner and reports its
+   cost per tick as the snake grows.
+   With --world it plays on huge chunked worlds of growing size and shows the
+   cost per tick and the memory follow the snake, not the world.
+   With --swarm it plays with 100 to 3200 rival snakes on boards growing with
+   them and shows the cost per tick follows the segments on the board, next
+   to checking every head against every body.
+   With --broadcast (Linux) it streams frames to a growing number of
+   spectators, half of which read slowly, and times the game thread's side. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#if defined(__linux__)
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#include "game.h"
+#include "render.h"
+#include "history.h"
+#include "sim.h"
+#include "env.h"
+#include "autopilot.h"
+#include "world.h"
+#include "swarm.h"
+#include "broadcast.h"
+
+#define LATENCY_BUCKETS 65536 // 1 ns per bucket, slower ticks land in the overflow counter
+
+/* Host hooks */
+void die(const char *s) {
+    perror(s);
+    exit(1);
+}
+
+static long long alloc_count = 0;
+
+static void *counting_alloc(size_t size) {
+    alloc_count++;
+    return malloc(size);
+}
+
+/* Timing */
+static long long now_ns() {
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER counter;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (long long)(counter.QuadPart * (1000000000.0 / freq.QuadPart));
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+typedef struct {
+    long long buckets[LATENCY_BUCKETS];
+    long long overflow;  // ticks slower than LATENCY_BUCKETS ns
+    long long max;
+    long long count;
+} LatencyHistogram;
+
+static void latency_add(LatencyHistogram *h, long long ns) {
+    if (ns < LATENCY_BUCKETS) h->buckets[ns]++;
+    else h->overflow++;
+    if (ns > h->max) h->max = ns;
+    h->count++;
+}
+
+static long long latency_percentile(const LatencyHistogram *h, double p) {
+    long long rank = (long long)(p / 100.0 * (h->count - 1)) + 1;
+    long long seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) return i;
+    }
+    return h->max;
+}
+
+// clock of the --stats phase timers
+static int64_t stats_clock(void) {
+    return (int64_t)now_ns();
+}
+
+// board size of every mode, --rows/--cols
+static int board_rows = DEFAULT_GRID_ROWS;
+static int board_cols = DEFAULT_GRID_COLS;
+
+static void bench_config(GameConfig *config, uint64_t seed) {
+    game_config_default(config);
+    config->rows = board_rows;
+    config->cols = board_cols;
+    config->seed = seed;
+}
+
+static void start_game(GameState *state, uint64_t seed) {
+    GameConfig config;
+    bench_config(&config, seed);
+    game_init(state, &config);
+}
+
+// next game in the memory of the last one
+static void restart_game(GameState *state, uint64_t seed) {
+    GameConfig config;
+    bench_config(&config, seed);
+    game_reset(state, &config);
+}
+
+/* Input policies */
+typedef struct {
+    char *moves;         // one of "UDLR." per tick, '.' keeps the current direction
+    long length;
+    long position;
+} Script;
+
+static enum direction script_next(Script *script, enum direction current) {
+    char c = script->moves[script->position++];
+    if (script->position == script->length) script->position = 0;
+    switch (c) {
+        case 'U': return UP;
+        case 'D': return DOWN;
+        case 'L': return LEFT;
+        case 'R': return RIGHT;
+        default: return current;
+    }
+}
+
+static int load_script(Script *script, const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return 0;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    script->moves = malloc(size > 0 ? size : 1);
+    if (!script->moves) die("malloc");
+    script->length = 0;
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        if (c == 'U' || c == 'D' || c == 'L' || c == 'R' || c == '.') script->moves[script->length++] = (char)c;
+    }
+    fclose(file);
+    script->position = 0;
+    return script->length > 0;
+}
+
+// a cell the snake can step into without dying on this tick
+/* Composer benchmark */
+// the renderer as it was before render.c: full grid, sprintf and a colour reset around every coloured cell
+static size_t compose_legacy(const GameState *state, char *out) {
+    char *p = out;
+    p += sprintf(p, ESC "[?25l");
+    *p++ = '\n';
+    for (int i = 0; i < state->rows; i++) {
+        for (int j = 0; j < state->cols; j++) {
+            char cell = get_cell_state(state, i, j);
+            switch (cell) {
+                case FOOD_CHAR:
+                    p += sprintf(p, "%s%c%s", COLOR_FOOD, FOOD_CHAR, COLOR_RESET);
+                    break;
+                case SNAKE_HEAD_CHAR:
+                case SNAKE_BODY_CHAR:
+                    p += sprintf(p, "%s%c%s", COLOR_SNAKE, cell, COLOR_RESET);
+                    break;
+                default:
+                    *p++ = cell;
+                    break;
+            }
+        }
+        *p++ = '\n';
+    }
+    if (state->score >= LEVEL_UPGRADE_SCORE) {
+        p += sprintf(p, "New Power unlocked: Snake can now wrap around walls\n");
+    } else {
+        p += sprintf(p, "Use arrow keys to move the snake, eat the '$' before it gets eaten\n");
+    }
+    p += sprintf(p, "Score: %d\n", state->score);
+    return p - out;
+}
+
+typedef struct {
+    const char *name;
+    long long bytes;
+    long long ns;
+} ComposeResult;
+
+static void bench_compose(long long frames, uint64_t seed) {
+    static Renderer full, delta;
+    ComposeResult results[] = { { "legacy sprintf", 0, 0 }, { "full redraw", 0, 0 }, { "delta", 0, 0 } };
+    GameState *state = malloc(sizeof(GameState));
+    if (!state) die("malloc");
+
+    Rng input_rng;
+    rng_seed(&input_rng, seed ^ 0xA5A5A5A5ULL);
+    long long games = 1;
+    start_game(state, seed);
+    renderer_init(&full, 1, state->rows, state->cols);
+    renderer_init(&delta, 0, state->rows, state->cols);
+    char *legacy_frame = malloc((size_t)state->rows * state->cols * 11 + 150);
+    if (!legacy_frame) die("malloc");
+
+    for (long long f = 0; f < frames; f++) {
+        if (state->game_over) {
+            restart_game(state, seed + games);
+            renderer_invalidate(&delta);
+            games++;
+        }
+        state->dir = sim_random_policy(state, &input_rng, NULL);
+        compute_game_state(state);
+
+        long long t0 = now_ns();
+        results[0].bytes += compose_legacy(state, legacy_frame);
+        long long t1 = now_ns();
+        results[1].bytes += render_frame(&full, state);
+        long long t2 = now_ns();
+        results[2].bytes += render_frame(&delta, state);
+        long long t3 = now_ns();
+        results[0].ns += t1 - t0;
+        results[1].ns += t2 - t1;
+        results[2].ns += t3 - t2;
+    }
+
+    printf("frames:       %lld in %lld games\n", frames, games);
+    for (int i = 0; i < 3; i++) {
+        printf("%-14s %10.1f bytes/frame %10.1f ns/frame\n", results[i].name,
+               (double)results[i].bytes / frames, (double)results[i].ns / frames);
+    }
+    game_free(state);
+    free(state);
+    free(legacy_frame);
+    renderer_free(&full);
+    renderer_free(&delta);
+}
+
+/* Enemy update benchmark */
+static void bench_enemies(long long ticks, uint64_t seed) {
+    static const int pool_sizes[] = { 1, 10, 100, 1000, 10000 };
+    GameState *state = malloc(sizeof(GameState));
+    if (!state) die("malloc");
+
+    printf("%8s %12s %14s\n", "enemies", "ns/update", "ns/enemy");
+    for (size_t n = 0; n < sizeof(pool_sizes) / sizeof(pool_sizes[0]); n++) {
+        int enemies = pool_sizes[n];
+        GameConfig config;
+        bench_config(&config, seed);
+        config.max_enemies = enemies;
+        game_init(state, &config);
+
+        // the snake stands still, enemies may share cells once the board is crowded
+        for (int i = 0; i < enemies; i++) {
+            spawn_enemy(state, rng_range(&state->rng, state->cols - 2) + 1, rng_range(&state->rng, state->rows - 2) + 1);
+        }
+        // same total work for every pool size, at least a few hundred updates each
+        long long updates = ticks / enemies;
+        if (updates < 200) updates = 200;
+
+        long long start = now_ns();
+        for (long long t = 0; t < updates; t++) {
+            compute_enemy_position(state);
+        }
+        double per_update = (double)(now_ns() - start) / updates;
+        printf("%8d %12.1f %14.2f\n", enemies, per_update, per_update / enemies);
+        game_free(state);
+    }
+    free(state);
+}
+
+/* Flow field benchmark */
+static void bench_flow(uint64_t seed) {
+    // the game's playable area first, then boards far larger than a terminal
+    static const int sizes[][2] = { { DEFAULT_GRID_COLS - 2, DEFAULT_GRID_ROWS - 2 }, { 256, 256 }, { 1024, 1024 }, { 2048, 2048 } };
+    Rng rng;
+    rng_seed(&rng, seed);
+
+    printf("%11s %14s %14s %10s\n", "grid", "rebuild ns", "update ns", "speedup");
+    for (size_t n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+        FlowField flow;
+        Arena arena;
+        int width = sizes[n][0], height = sizes[n][1];
+        arena_init(&arena, flow_arena_size(width, height));
+        flow_init(&flow, &arena, width, height);
+        int iterations = (int)(20000000LL / flow.size);
+        if (iterations < 20) iterations = 20;
+
+        // scattered obstacles, then every iteration one cell gets blocked and
+        // another one freed, like the snake's head and tail
+        for (int i = 0; i < flow.size / 10; i++) flow_set_blocked(&flow, rng_range(&rng, flow.size), 1);
+        int target = rng_range(&rng, flow.size);
+        flow_set_blocked(&flow, target, 0);
+
+        long long rebuild_ns = 0, update_ns = 0;
+        flow_rebuild(&flow, target);
+        for (int i = 0; i < iterations; i++) {
+            int block = rng_range(&rng, flow.size);
+            int unblock = rng_range(&rng, flow.size);
+            if (block != target) flow_set_blocked(&flow, block, 1);
+            flow_set_blocked(&flow, unblock, 0);
+
+            long long start = now_ns();
+            flow_update(&flow);
+            update_ns += now_ns() - start;
+        }
+        for (int i = 0; i < iterations; i++) {
+            long long start = now_ns();
+            flow_rebuild(&flow, target);
+            rebuild_ns += now_ns() - start;
+        }
+
+        char grid[32];
+        snprintf(grid, sizeof(grid), "%dx%d", width, height);
+        printf("%11s %14.0f %14.0f %9.1fx\n", grid, (double)rebuild_ns / iterations,
+               (double)update_ns / iterations, (double)rebuild_ns / (update_ns ? update_ns : 1));
+        arena_free(&arena);
+    }
+}
+
+/* Occupancy query benchmark */
+// count and nth free cell the way a glyph grid answers them: one cell at a time
+static int scan_count_free(const char *glyphs, int area) {
+    int count = 0;
+    for (int i = 0; i < area; i++) count += glyphs[i] == EMPTY_CHAR;
+    return count;
+}
+
+static int scan_nth_free(const char *glyphs, int area, int n) {
+    for (int i = 0; i < area; i++) {
+        if (glyphs[i] == EMPTY_CHAR && n-- == 0) return i;
+    }
+    return -1;
+}
+
+static void bench_queries(long long queries, uint64_t seed) {
+    GameState *state = malloc(sizeof(GameState));
+    if (!state) die("malloc");
+
+    // a crowded board: long random game with many enemies
+    GameConfig config;
+    bench_config(&config, seed);
+    config.max_enemies = 200;
+    game_init(state, &config);
+    int area = state->rows * state->cols;
+    char *glyphs = malloc(area);
+    if (!glyphs) die("malloc");
+    for (int i = 0; i < 200; i++) {
+        spawn_enemy(state, rng_range(&state->rng, state->cols - 2) + 1, rng_range(&state->rng, state->rows - 2) + 1);
+    }
+    game_render_glyphs(state, glyphs);
+    int free_cells = game_count_free(state);
+    if (free_cells != scan_count_free(glyphs, area)) die("free cell count mismatch");
+
+    Rng rng;
+    rng_seed(&rng, seed);
+    long long check = 0;
+    long long t0 = now_ns();
+    for (long long q = 0; q < queries; q++) check += scan_count_free(glyphs, area);
+    long long t1 = now_ns();
+    for (long long q = 0; q < queries; q++) check += game_count_free(state);
+    long long t2 = now_ns();
+    for (long long q = 0; q < queries; q++) check += scan_nth_free(glyphs, area, rng_range(&rng, free_cells));
+    long long t3 = now_ns();
+    for (long long q = 0; q < queries; q++) check += game_nth_free(state, rng_range(&rng, free_cells));
+    long long t4 = now_ns();
+    for (long long q = 0; q < queries; q++) {
+        int index = rng_range(&rng, area);
+        char cell = get_cell_state(state, index / state->cols, index % state->cols);
+        check += cell == SNAKE_BODY_CHAR || cell == ENEMY_CHAR;
+    }
+    long long t5 = now_ns();
+    for (long long q = 0; q < queries; q++) {
+        int index = rng_range(&rng, area);
+        int row = index / state->cols, col = index % state->cols;
+        check += cell_test(state, LAYER_BODY, row, col) | cell_test(state, LAYER_ENEMY, row, col);
+    }
+    long long t6 = now_ns();
+
+    printf("free cells:   %d of %d (checksum %lld)\n", free_cells, area, check);
+    printf("%-12s %14s %14s\n", "query", "glyph scan ns", "bitboard ns");
+    printf("%-12s %14.1f %14.1f\n", "count free", (double)(t1 - t0) / queries, (double)(t2 - t1) / queries);
+    printf("%-12s %14.1f %14.1f\n", "nth free", (double)(t3 - t2) / queries, (double)(t4 - t3) / queries);
+    printf("%-12s %14.1f %14.1f\n", "collision", (double)(t5 - t4) / queries, (double)(t6 - t5) / queries);
+    game_free(state);
+    free(state);
+    free(glyphs);
+}
+
+// a snake of `length` segments winding row by row over the playable area, head last
+static void lay_snake(GameState *state, int length) {
+    SnakeBody *body = &state->snake;
+    while (body->length > 0) {
+        SnakeSegment *tail = snake_tail(body);
+        cell_clear(state, LAYER_BODY, tail->y, tail->x);
+        cell_clear(state, LAYER_HEAD, tail->y, tail->x);
+        snake_pop_tail(body);
+    }
+    int width = state->cols - 2;
+    for (int i = 0; i < length; i++) {
+        int row = i / width;
+        int col = row % 2 ? width - 1 - i % width : i % width;
+        if (body->length > 0) {
+            SnakeSegment *head = snake_head(body);
+            cell_clear(state, LAYER_HEAD, head->y, head->x);
+            cell_set(state, LAYER_BODY, head->y, head->x);
+        }
+        snake_push_head(body, col + 1, row + 1);
+        cell_set(state, LAYER_HEAD, row + 1, col + 1);
+    }
+}
+
+// the layout snapshots replace: a malloc'd list of segments next to a screen buffer
+typedef struct ListSegment {
+    int x, y;
+    struct ListSegment *next;
+} ListSegment;
+
+static ListSegment *copy_list(const ListSegment *list) {
+    ListSegment *head = NULL, **link = &head;
+    for (; list; list = list->next) {
+        ListSegment *segment = malloc(sizeof(ListSegment));
+        if (!segment) die("malloc");
+        *segment = *list;
+        *link = segment;
+        link = &segment->next;
+    }
+    return head;
+}
+
+static void free_list(ListSegment *list) {
+    while (list) {
+        ListSegment *next = list->next;
+        free(list);
+        list = next;
+    }
+}
+
+static void bench_snapshots(long long ticks, uint64_t seed) {
+    static const int lengths[] = { 1, 10, 100, 1000, 10000, 100000 };
+    GameState *state = malloc(sizeof(GameState));
+    if (!state) die("malloc");
+    GameConfig config;
+    bench_config(&config, seed);
+    game_init(state, &config);
+    History history;
+    history_init(&history, state, 1);
+    int area = state->rows * state->cols;
+    char *screen = malloc(area), *screen_copy = malloc(area);
+    if (!screen || !screen_copy) die("malloc");
+    game_render_glyphs(state, screen);
+
+    long long reps = ticks / 1000;
+    if (reps < 100) reps = 100;
+    printf("snapshot: %zu bytes, one memcpy whatever the length\n", state->snapshot_bytes + sizeof(GameState));
+    printf("%8s %14s %14s %16s\n", "length", "ns/snapshot", "ns/restore", "ns/list copy");
+    for (size_t n = 0; n < sizeof(lengths) / sizeof(lengths[0]); n++) {
+        int length = lengths[n];
+        if (length > (state->rows - 2) * (state->cols - 2) - 1) break;
+        lay_snake(state, length);
+        ListSegment *list = NULL;
+        for (int i = 0; i < length; i++) {
+            ListSegment *segment = malloc(sizeof(ListSegment));
+            if (!segment) die("malloc");
+            segment->x = i;
+            segment->y = 0;
+            segment->next = list;
+            list = segment;
+        }
+
+        long long start = now_ns();
+        for (long long r = 0; r < reps; r++) history_push(&history, state);
+        double snapshot = (double)(now_ns() - start) / reps;
+
+        start = now_ns();
+        for (long long r = 0; r < reps; r++) {
+            history_pop(&history, state);
+            history.count = 1; // pop the same snapshot again
+        }
+        double restore = (double)(now_ns() - start) / reps;
+
+        double list_copy = 0;
+        for (long long r = 0; r < reps; r++) {
+            start = now_ns();
+            ListSegment *copy = copy_list(list);
+            memcpy(screen_copy, screen, area);
+            list_copy += now_ns() - start;
+            free_list(copy);
+        }
+        printf("%8d %14.1f %14.1f %16.1f\n", length, snapshot, restore, list_copy / reps);
+        free_list(list);
+    }
+    history_free(&history);
+    game_free(state);
+    free(state);
+    free(screen);
+    free(screen_copy);
+}
+
+static void print_distribution(const char *name, const Histogram *histogram) {
+    printf("%-10s p50 %lld  p90 %lld  p99 %lld  max %lld  mean %.1f\n", name,
+           (long long)histogram_percentile(histogram, 50), (long long)histogram_percentile(histogram, 90),
+           (long long)histogram_percentile(histogram, 99), (long long)histogram->max, histogram_mean(histogram));
+}
+
+static void bench_sim(long long games, int threads, uint64_t seed) {
+    SimConfig config;
+    sim_config_default(&config);
+    bench_config(&config.config, seed);
+    config.games = games;
+    SimResult *result = malloc(sizeof(SimResult));
+    if (!result) die("malloc");
+
+    // thread counts doubling up to the cores, or just the one asked for
+    int max_threads = threads > 0 ? threads : sim_cpu_count();
+    double base = 0;
+    printf("%8s %12s %14s %9s %8s\n", "threads", "games/sec", "ticks/sec", "speedup", "steals");
+    for (int count = threads > 0 ? threads : 1;; count = count * 2 < max_threads ? count * 2 : max_threads) {
+        config.threads = count;
+        sim_run(&config, result);
+        double rate = result->games / result->seconds;
+        if (base == 0) base = rate;
+        printf("%8d %12.0f %14.0f %8.2fx %8lld\n", result->threads, rate, result->ticks / result->seconds, rate / base, result->steals);
+        if (count == max_threads) break;
+    }
+    // the same games whatever the thread count, so the last run speaks for all of them
+    printf("games:     %lld, %lld cut off at %d ticks\n", result->games, result->cut_off, SIM_DEFAULT_MAX_TICKS);
+    print_distribution("score:", &result->scores);
+    print_distribution("survival:", &result->survival);
+    free(result);
+}
+
+static void bench_env(long long ticks, int count, uint64_t seed) {
+    GameConfig config;
+    bench_config(&config, seed);
+    SnakeEnv env;
+    snake_env_init(&env, count, &config, SIM_DEFAULT_MAX_TICKS);
+    size_t obs_size = snake_env_obs_size(&env);
+    uint8_t *obs = malloc(obs_size * count);
+    int *actions = malloc(sizeof(int) * count);
+    float *rewards = malloc(sizeof(float) * count);
+    uint8_t *dones = malloc(count);
+    if (!obs || !actions || !rewards || !dones) die("malloc");
+
+    Rng rng;
+    rng_seed(&rng, seed ^ 0xA5A5A5A5ULL);
+    snake_env_reset(&env, obs);
+    long long steps = ticks / count > 0 ? ticks / count : 1;
+    long long start = now_ns();
+    for (long long t = 0; t < steps; t++) {
+        // mostly keep going, like an agent that isn't completely lost
+        for (int i = 0; i < count; i++) actions[i] = rng_range(&rng, 8) < 6 ? NONE : rng_range(&rng, 4);
+        snake_env_step(&env, actions, obs, rewards, dones);
+    }
+    long long elapsed = now_ns() - start;
+
+    double env_steps = (double)steps * count;
+    printf("envs:          %d of %dx%d, %zu observation bytes each\n", count, env.rows, env.cols, obs_size);
+    printf("env-steps/sec: %.0f (%.1f ns each, observation included)\n", env_steps / (elapsed / 1e9), elapsed / env_steps);
+    printf("observations:  %.2f GB/s\n", env_steps * obs_size / elapsed);
+    printf("episodes:      %lld\n", env.episodes);
+    snake_env_free(&env);
+    free(obs);
+    free(actions);
+    free(rewards);
+    free(dones);
+}
+
+#define AUTOPILOT_BANDS 6 // snake lengths up to 16, 64, 256, 1024, 4096 and beyond
+
+static void bench_autopilot(long long ticks, int budget, uint64_t seed) {
+    static const char *band_names[AUTOPILOT_BANDS] = { "1-15", "16-63", "64-255", "256-1023", "1024-4095", "4096+" };
+    Histogram *plan_ns = calloc(AUTOPILOT_BANDS, sizeof(Histogram));
+    Histogram *results = calloc(2, sizeof(Histogram)); // scores, survival
+    GameState *state = malloc(sizeof(GameState));
+    Autopilot *autopilot = malloc(sizeof(Autopilot));
+    if (!plan_ns || !results || !state || !autopilot) die("malloc");
+    int max_work[AUTOPILOT_BANDS] = { 0 };
+
+    start_game(state, seed);
+    autopilot_init(autopilot, state, budget);
+    long long games = 0, game_ticks = 0, longest = 0;
+    for (long long t = 0; t < ticks; t++) {
+        if (state->game_over || game_ticks == SIM_DEFAULT_MAX_TICKS) {
+            histogram_record(&results[0], state->score);
+            histogram_record(&results[1], game_ticks);
+            games++;
+            game_ticks = 0;
+            restart_game(state, seed + games);
+            autopilot_reset(autopilot);
+        }
+        int band = 0;
+        for (int length = state->snake.length; length >= 16 && band < AUTOPILOT_BANDS - 1; length >>= 2) band++;
+
+        long long start = now_ns();
+        state->dir = autopilot_next(autopilot, state);
+        histogram_record(&plan_ns[band], now_ns() - start);
+        if (autopilot->work > max_work[band]) max_work[band] = autopilot->work;
+        if (state->snake.length > longest) longest = state->snake.length;
+
+        compute_game_state(state);
+        game_ticks++;
+    }
+
+    printf("board:      %dx%d, budget %d cells per tick\n", state->rows, state->cols, autopilot->budget);
+    printf("ticks:      %lld, %lld planned, %lld on an earlier path, %lld fallback, %lld out of budget\n",
+           ticks, autopilot->plans, autopilot->reused, autopilot->fallbacks, autopilot->exhausted);
+    printf("%-10s %10s %10s %10s %10s %10s\n", "length", "ticks", "p50 ns", "p99 ns", "max ns", "max cells");
+    for (int band = 0; band < AUTOPILOT_BANDS; band++) {
+        if (plan_ns[band].count == 0) continue;
+        printf("%-10s %10llu %10lld %10lld %10lld %10d\n", band_names[band], (unsigned long long)plan_ns[band].count,
+               (long long)histogram_percentile(&plan_ns[band], 50), (long long)histogram_percentile(&plan_ns[band], 99),
+               (long long)plan_ns[band].max, max_work[band]);
+    }
+    printf("games:      %lld finished, longest snake %lld\n", games, longest);
+    if (games > 0) {
+        print_distribution("score:", &results[0]);
+        print_distribution("survival:", &results[1]);
+    }
+    autopilot_free(autopilot);
+    game_free(state);
+    free(autopilot);
+    free(state);
+    free(results);
+    free(plan_ns);
+}
+
+// toward the food, or anywhere open; the world's snake has no flow field to follow
+static enum direction world_policy(const World *world, Rng *rng) {
+    static const int step_dx[] = { 0, 0, -1, 1 };
+    static const int step_dy[] = { -1, 1, 0, 0 };
+    const SnakeSegment *head = &world->snake.segments[world->snake.head];
+    enum direction open[4];
+    int count = 0;
+    for (int d = 0; d < 4; d++) {
+        int x = head->x + step_dx[d], y = head->y + step_dy[d];
+        if (world_blocked(world, x, y)) continue;
+        if (world->food_x >= 0 && abs(world->food_x - x) + abs(world->food_y - y) <
+                                  abs(world->food_x - head->x) + abs(world->food_y - head->y)) return (enum direction)d;
+        open[count++] = (enum direction)d;
+    }
+    if (count == 0) return world->dir == NONE ? UP : world->dir;
+    return open[rng_range(rng, count)];
+}
+
+static void bench_world(long long ticks, uint64_t seed) {
+    static const int sizes[] = { 1000, 10000, 100000, 1000000 };
+    Histogram *tick_ns = malloc(sizeof(Histogram));
+    World *world = malloc(sizeof(World));
+    if (!tick_ns || !world) die("malloc");
+
+    printf("view %dx%d, %lld ticks per world\n", board_rows, board_cols, ticks);
+    printf("%-15s %8s %8s %8s %8s %8s %10s %10s\n", "world", "games", "best", "p50 ns", "p99 ns", "max ns",
+           "max chunks", "max KB");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        GameConfig config;
+        bench_config(&config, seed);
+        config.rows = config.cols = sizes[s];
+        memset(tick_ns, 0, sizeof(Histogram));
+        Rng input_rng;
+        rng_seed(&input_rng, seed ^ 0xA5A5A5A5ULL);
+
+        world_init(world, &config, board_rows, board_cols);
+        long long games = 1;
+        int best = 0, max_chunks = 0;
+        size_t max_memory = 0;
+        for (long long t = 0; t < ticks; t++) {
+            if (world->game_over) {
+                if (world->score > best) best = world->score;
+                world_free(world);
+                config.seed = seed + games++;
+                world_init(world, &config, board_rows, board_cols);
+            }
+            world->dir = world_policy(world, &input_rng);
+            long long start = now_ns();
+            world_tick(world);
+            histogram_record(tick_ns, now_ns() - start);
+            if (world->chunks > max_chunks) max_chunks = world->chunks;
+            if (world_memory(world) > max_memory) max_memory = world_memory(world);
+        }
+        if (world->score > best) best = world->score;
+        printf("%7dx%-7d %8lld %8d %8lld %8lld %8lld %10d %10zu\n", sizes[s], sizes[s], games, best,
+               (long long)histogram_percentile(tick_ns, 50), (long long)histogram_percentile(tick_ns, 99),
+               (long long)tick_ns->max, max_chunks, max_memory / 1024);
+        world_free(world);
+    }
+    free(world);
+    free(tick_ns);
+}
+
+// what resolving collisions costs without the owner grid: every head against every segment
+// of every body, walked along the links
+static long long pairwise_collisions(const Swarm *swarm) {
+    static const int step_dx[] = { 0, 0, -1, 1 };
+    static const int step_dy[] = { -1, 1, 0, 0 };
+    long long hits = 0;
+    for (int id = 0; id < swarm->snake_count; id++) {
+        if (!swarm->length[id]) continue;
+        int next = swarm->head[id] + step_dy[swarm->heading[id]] * swarm->cols + step_dx[swarm->heading[id]];
+        for (int other = 0; other < swarm->snake_count; other++) {
+            int cell = swarm->tail[other];
+            for (int i = 0; i < swarm->length[other]; i++) {
+                hits += cell == next;
+                cell = swarm->link[cell];
+            }
+        }
+    }
+    return hits;
+}
+
+static void bench_swarm(long long moves, uint64_t seed) {
+    static const int sizes[] = { 100, 200, 400, 800, 1600, 3200 };
+    Histogram *tick_ns = malloc(sizeof(Histogram));
+    Swarm *swarm = malloc(sizeof(Swarm));
+    if (!tick_ns || !swarm) die("malloc");
+
+    printf("%lld snake moves per size, boards of %d cells per rival\n", moves, 4 * SWARM_CELLS_PER_RIVAL);
+    printf("%6s %10s %8s %10s %8s %8s %8s %10s %12s\n", "rivals", "board", "ticks", "segments", "p50 ns",
+           "p99 ns", "ns/seg", "deaths", "pairwise ns");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        GameConfig config;
+        bench_config(&config, seed);
+        // four times as wide as high, like a terminal
+        int cells = sizes[s] * 4 * SWARM_CELLS_PER_RIVAL;
+        config.rows = 2;
+        while (config.rows * config.rows * 4 < cells) config.rows++;
+        config.cols = cells / config.rows;
+        memset(tick_ns, 0, sizeof(Histogram));
+
+        swarm_init(swarm, &config, sizes[s]);
+        long long ticks = moves / (sizes[s] + 1), deaths = 0;
+        double segments = 0;
+        long long pairwise = 0, samples = 0;
+        volatile long long hits = 0; // keeps the pairwise check from being optimized out
+        for (long long t = 0; t < ticks; t++) {
+            if (swarm->game_over) {
+                deaths += swarm->deaths;
+                swarm_free(swarm);
+                config.seed++;
+                swarm_init(swarm, &config, sizes[s]);
+            }
+            swarm->dir = swarm_steer(swarm, 0);
+            long long start = now_ns();
+            swarm_tick(swarm);
+            histogram_record(tick_ns, now_ns() - start);
+            segments += (double)swarm->segments;
+            // a few samples are plenty, the pairwise check is what doesn't scale
+            if (t % (ticks / 8 + 1) == 0) {
+                start = now_ns();
+                hits += pairwise_collisions(swarm);
+                pairwise += now_ns() - start;
+                samples++;
+            }
+        }
+        deaths += swarm->deaths;
+        double mean_segments = segments / (ticks > 0 ? ticks : 1);
+        printf("%6d %4dx%-5d %8lld %10.0f %8lld %8lld %8.2f %10lld %12lld\n", sizes[s], config.rows, config.cols,
+               ticks, mean_segments, (long long)histogram_percentile(tick_ns, 50),
+               (long long)histogram_percentile(tick_ns, 99), histogram_mean(tick_ns) / mean_segments, deaths,
+               pairwise / (samples > 0 ? samples : 1));
+        swarm_free(swarm);
+    }
+    free(swarm);
+    free(tick_ns);
+}
+
+#if defined(__linux__)
+#define BENCH_SPECTATORS 1024
+
+#define BENCH_SLOW_READ_NS 100000000LL // slow spectators read once per 100 ms
+
+typedef struct {
+    int fds[BENCH_SPECTATORS];
+    int count;                   // Spectators that keep up
+    int slow[BENCH_SPECTATORS];
+    int slow_count;              // Spectators that read a little now and then
+    volatile int stop;
+    long long bytes;
+} Audience;
+
+static long long read_spectator(int fd, char *buf, size_t size) {
+    ssize_t got = recv(fd, buf, size, MSG_DONTWAIT);
+    return got > 0 ? got : 0;
+}
+
+// the fast half reads everything as it comes, the slow half 4 KB every BENCH_SLOW_READ_NS
+static void *drain_audience(void *arg) {
+    Audience *audience = arg;
+    static struct pollfd fds[BENCH_SPECTATORS];
+    char buf[65536];
+    for (int i = 0; i < audience->count; i++) {
+        fds[i].fd = audience->fds[i];
+        fds[i].events = POLLIN;
+    }
+    long long slow_read = now_ns();
+    while (!audience->stop) {
+        if (poll(fds, audience->count, 10) > 0) {
+            for (int i = 0; i < audience->count; i++) {
+                if (fds[i].revents & POLLIN) audience->bytes += read_spectator(fds[i].fd, buf, sizeof(buf));
+            }
+        }
+        if (now_ns() - slow_read >= BENCH_SLOW_READ_NS) {
+            for (int i = 0; i < audience->slow_count; i++) {
+                audience->bytes += read_spectator(audience->slow[i], buf, 4096);
+            }
+            slow_read = now_ns();
+        }
+    }
+    return NULL;
+}
+
+static int connect_spectator(const char *path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0) die("connect");
+    return fd;
+}
+
+static void bench_broadcast(long long frames, uint64_t seed) {
+    static const int counts[] = { 0, 1, 10, 100, 500, 1000 };
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/snake_bench.%d.sock", (int)getpid());
+    Histogram *publish_ns = malloc(sizeof(Histogram));
+    GameState *state = malloc(sizeof(GameState));
+    Audience *audience = malloc(sizeof(Audience));
+    char *glyphs = malloc((size_t)board_rows * board_cols);
+    if (!publish_ns || !state || !audience || !glyphs) die("malloc");
+
+    printf("board %dx%d, %lld frames per run, half the spectators slow readers\n", board_rows, board_cols, frames);
+    printf("%-10s %8s %8s %8s %10s %10s %10s %12s\n", "spectators", "p50 ns", "p99 ns", "max ns", "composed",
+           "keyframes", "lapped", "MB read");
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        Broadcast broadcast;
+        if (!broadcast_start(&broadcast, path, board_rows, board_cols)) die("broadcast_start");
+        memset(audience, 0, sizeof(*audience));
+        for (int i = 0; i < counts[c]; i++) {
+            int fd = connect_spectator(path);
+            if (i % 2 == 0) audience->fds[audience->count++] = fd;
+            else audience->slow[audience->slow_count++] = fd;
+        }
+        pthread_t reader;
+        if (pthread_create(&reader, NULL, drain_audience, audience)) die("pthread_create");
+
+        Rng input_rng;
+        rng_seed(&input_rng, seed ^ 0xA5A5A5A5ULL);
+        start_game(state, seed);
+        memset(publish_ns, 0, sizeof(Histogram));
+        long long games = 1;
+        for (long long f = 0; f < frames; f++) {
+            if (state->game_over) restart_game(state, seed + games++);
+            state->dir = sim_random_policy(state, &input_rng, NULL);
+            compute_game_state(state);
+            game_render_glyphs(state, glyphs);
+            long long start = now_ns();
+            broadcast_publish(&broadcast, glyphs, state->score);
+            histogram_record(publish_ns, now_ns() - start);
+        }
+        broadcast_stop(&broadcast);
+        audience->stop = 1;
+        pthread_join(reader, NULL);
+        for (int i = 0; i < audience->count; i++) close(audience->fds[i]);
+        for (int i = 0; i < audience->slow_count; i++) close(audience->slow[i]);
+        game_free(state);
+
+        printf("%-10d %8lld %8lld %8lld %10lld %10lld %10lld %12.1f\n", counts[c],
+               (long long)histogram_percentile(publish_ns, 50), (long long)histogram_percentile(publish_ns, 99),
+               (long long)publish_ns->max, broadcast.composed, broadcast.keyframes, broadcast.lapped,
+               audience->bytes / 1e6);
+    }
+    free(glyphs);
+    free(audience);
+    free(state);
+    free(publish_ns);
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    long long ticks = 10000000;
+    uint64_t seed = 1;
+    const char *script_path = NULL;
+    const char *stats_path = NULL;
+    int compose = 0;
+    int enemies = 0;
+    int flow = 0;
+    int queries = 0;
+    int snapshots = 0;
+    int sim = 0;
+    long long sim_games = 10000;
+    int threads = 0;
+    int env = 0;
+    int envs = 256;
+    int autopilot = 0;
+    int budget = AUTOPILOT_DEFAULT_BUDGET;
+    int huge = 0;
+    int rivals = 0;
+    int spectators = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--ticks") && i + 1 < argc) {
+            ticks = atoll(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--rows") && i + 1 < argc) {
+            board_rows = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--cols") && i + 1 < argc) {
+            board_cols = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--script") && i + 1 < argc) {
+            script_path = argv[++i];
+        } else if (!strcmp(argv[i], "--stats") && i + 1 < argc) {
+            stats_path = argv[++i];
+        } else if (!strcmp(argv[i], "--compose")) {
+            compose = 1;
+        } else if (!strcmp(argv[i], "--enemies")) {
+            enemies = 1;
+        } else if (!strcmp(argv[i], "--flow")) {
+            flow = 1;
+        } else if (!strcmp(argv[i], "--queries")) {
+            queries = 1;
+        } else if (!strcmp(argv[i], "--snapshots")) {
+            snapshots = 1;
+        } else if (!strcmp(argv[i], "--sim")) {
+            sim = 1;
+        } else if (!strcmp(argv[i], "--games") && i + 1 < argc) {
+            sim_games = atoll(argv[++i]);
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--env")) {
+            env = 1;
+        } else if (!strcmp(argv[i], "--envs") && i + 1 < argc) {
+            envs = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--autopilot")) {
+            autopilot = 1;
+        } else if (!strcmp(argv[i], "--budget") && i + 1 < argc) {
+            budget = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--world")) {
+            huge = 1;
+        } else if (!strcmp(argv[i], "--swarm")) {
+            rivals = 1;
+        } else if (!strcmp(argv[i], "--broadcast")) {
+            spectators = 1;
+        } else if (!strcmp(argv[i], "--help")) {
+            printf("Usage: snake_bench [--ticks <n>] [--seed <n>] [--rows <n>] [--cols <n>] [--script <file>] [--stats <file>] [--compose | --enemies | --flow | --queries | --snapshots | --sim [--games <n>] [--threads <n>] | --env [--envs <n>] | --autopilot [--budget <n>] | --world | --swarm | --broadcast]\n");
+            printf("Options:\n");
+            printf("  --ticks <n>      Number of ticks to simulate (default is 10000000)\n");
+            printf("  --seed <n>       Seed for the game and the random input (default is 1)\n");
+            printf("  --rows <n>       Board rows including the walls (default is %d)\n", DEFAULT_GRID_ROWS);
+            printf("  --cols <n>       Board columns including the walls (default is %d)\n", DEFAULT_GRID_COLS);
+            printf("  --script <file>  Replay moves from a file of U/D/L/R/. characters, one per tick\n");
+            printf("  --stats <file>   Time the snake and enemy phases of every tick, written as JSON or CSV like snake --stats\n");
+            printf("  --compose        Benchmark the frame composer for <n> frames instead of the simulation\n");
+            printf("  --enemies        Benchmark the enemy update with 1 to 10000 enemies, <n> enemy moves per size\n");
+            printf("  --flow           Compare full and incremental flow field updates on growing grids\n");
+            printf("  --queries        Compare <n> free cell and collision queries on bitboards and on glyphs\n");
+            printf("  --snapshots      Time <n>/1000 game-state snapshots and restores per snake length against a list copy\n");
+            printf("  --sim            Play --games <n> games (default is 10000) on the batch simulator with up to\n");
+            printf("                   --threads <n> threads (default is one per core) and report the scaling\n");
+            printf("  --env            Step --envs <n> environments (default is 256) for <n> env-steps in total\n");
+            printf("  --autopilot      Play <n> ticks with the autopilot, visiting at most --budget <n> cells per tick\n");
+            printf("                   (default is %d), and report its cost by snake length\n", AUTOPILOT_DEFAULT_BUDGET);
+            printf("  --world          Play <n> ticks on chunked worlds of 1000 to 1000000 cells a side, seen through\n");
+            printf("                   a --rows x --cols camera, and report the cost per tick and the memory\n");
+            printf("  --swarm          Play <n> snake moves with 100 to 3200 rival snakes on boards growing with them,\n");
+            printf("                   and report the cost per tick and per segment against a pairwise check\n");
+            printf("  --broadcast      Publish <n> frames to 0 to 1000 spectators, half of them slow readers, and time\n");
+            printf("                   the game thread's side (Linux)\n");
+            return 0;
+        } else {
+            printf("Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (compose) {
+        bench_compose(ticks, seed);
+        return 0;
+    }
+    if (enemies) {
+        bench_enemies(ticks, seed);
+        return 0;
+    }
+    if (flow) {
+        bench_flow(seed);
+        return 0;
+    }
+    if (queries) {
+        bench_queries(ticks, seed);
+        return 0;
+    }
+    if (snapshots) {
+        bench_snapshots(ticks, seed);
+        return 0;
+    }
+    if (sim) {
+        bench_sim(sim_games, threads, seed);
+        return 0;
+    }
+    if (env) {
+        bench_env(ticks, envs > 0 ? envs : 1, seed);
+        return 0;
+    }
+    if (autopilot) {
+        bench_autopilot(ticks, budget, seed);
+        return 0;
+    }
+    if (huge) {
+        bench_world(ticks, seed);
+        return 0;
+    }
+    if (rivals) {
+        bench_swarm(ticks, seed);
+        return 0;
+    }
+    if (spectators) {
+#if defined(__linux__)
+        bench_broadcast(ticks, seed);
+        return 0;
+#else
+        printf("--broadcast needs Linux\n");
+        return 1;
+#endif
+    }
+
+    Script script = { 0 };
+    if (script_path && !load_script(&script, script_path)) {
+        printf("Cannot read script: %s\n", script_path);
+        return 1;
+    }
+
+    GameAllocator allocator = { counting_alloc, free };
+    game_set_allocator(&allocator);
+
+    LatencyHistogram *latency = calloc(1, sizeof(LatencyHistogram));
+    GameState *state = malloc(sizeof(GameState));
+    Stats *stats = stats_path ? malloc(sizeof(Stats)) : NULL;
+    if (!latency || !state || (stats_path && !stats)) die("malloc");
+
+    Rng input_rng;
+    rng_seed(&input_rng, seed ^ 0xA5A5A5A5ULL);
+    long long games = 1;
+    long long tick_allocs = 0;
+    long long best_score = 0;
+    start_game(state, seed);
+    if (stats) {
+        // game_reset keeps the timers attached across restarts
+        stats_init(stats, stats_clock);
+        state->stats = stats;
+    }
+    long long startup_allocs = alloc_count;
+
+    long long start = now_ns();
+    for (long long t = 0; t < ticks; t++) {
+        if (state->game_over) {
+            if (state->score > best_score) best_score = state->score;
+            restart_game(state, seed + games);
+            games++;
+        }
+        state->dir = script_path ? script_next(&script, state->dir) : sim_random_policy(state, &input_rng, NULL);
+
+        long long allocs_before = alloc_count;
+        long long tick_start = now_ns();
+        compute_game_state(state);
+        latency_add(latency, now_ns() - tick_start);
+        tick_allocs += alloc_count - allocs_before;
+    }
+    long long elapsed = now_ns() - start;
+    if (state->score > best_score) best_score = state->score;
+
+    printf("ticks:        %lld in %lld games (best score %lld)\n", ticks, games, best_score);
+    printf("elapsed:      %.3f s\n", elapsed / 1e9);
+    printf("ticks/sec:    %.0f\n", ticks / (elapsed / 1e9));
+    printf("ns/tick:      p50 %lld  p90 %lld  p99 %lld  p99.9 %lld  max %lld\n",
+           latency_percentile(latency, 50), latency_percentile(latency, 90),
+           latency_percentile(latency, 99), latency_percentile(latency, 99.9), latency->max);
+    printf("allocs/tick:  %.6f\n", (double)tick_allocs / ticks);
+    // restarts included: every game after the first reuses the first one's arena
+    printf("allocs after startup: %lld\n", alloc_count - startup_allocs);
+    if (stats) {
+        stats->ticks = ticks;
+        if (!stats_write(stats, stats_path)) printf("Cannot write stats: %s\n", stats_path);
+    }
+
+    game_free(state);
+    free(state);
+    free(latency);
+    free(stats);
+    if (script_path) free(script.moves);
+    return 0;
+}
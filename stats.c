@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <string.h>
+#include "stats.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static const char *phase_names[PHASE_COUNT] = {
+    [PHASE_INPUT] = "input",
+    [PHASE_PLAN] = "plan",
+    [PHASE_SNAKE] = "snake",
+    [PHASE_ENEMIES] = "enemies",
+    [PHASE_PUBLISH] = "publish",
+    [PHASE_COMPOSE] = "compose",
+    [PHASE_WRITE] = "write",
+};
+
+void stats_init(Stats *stats, int64_t (*clock)(void)) {
+    memset(stats, 0, sizeof(*stats));
+    stats->clock = clock;
+}
+
+static inline int msb64(uint64_t x) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, x);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(x);
+#endif
+}
+
+// values below HISTOGRAM_SUB_BUCKETS are exact, then every power of two is cut in
+// HISTOGRAM_SUB_BUCKETS equal buckets
+static inline int bucket_of(uint64_t value) {
+    if (value < HISTOGRAM_SUB_BUCKETS) return (int)value;
+    int shift = msb64(value) - HISTOGRAM_SUB_BITS;
+    return (shift + 1) * HISTOGRAM_SUB_BUCKETS + (int)((value >> shift) & (HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+// largest value that lands in a bucket
+static int64_t bucket_top(int bucket) {
+    if (bucket < HISTOGRAM_SUB_BUCKETS) return bucket;
+    int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+    uint64_t sub = (uint64_t)(bucket % HISTOGRAM_SUB_BUCKETS);
+    return (int64_t)(((HISTOGRAM_SUB_BUCKETS + sub + 1) << shift) - 1);
+}
+
+void histogram_record(Histogram *histogram, int64_t value) {
+    if (value < 0) value = 0;
+    histogram->counts[bucket_of((uint64_t)value)]++;
+    histogram->count++;
+    histogram->sum += (double)value;
+    if (value > histogram->max) histogram->max = value;
+}
+
+int64_t histogram_percentile(const Histogram *histogram, double percent) {
+    if (histogram->count == 0) return 0;
+    uint64_t rank = (uint64_t)(histogram->count * percent / 100.0);
+    if (rank >= histogram->count) rank = histogram->count - 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if (seen > rank) {
+            int64_t top = bucket_top(i);
+            return top < histogram->max ? top : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+double histogram_mean(const Histogram *histogram) {
+    return histogram->count ? histogram->sum / histogram->count : 0;
+}
+
+void histogram_merge(Histogram *into, const Histogram *from) {
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) into->counts[i] += from->counts[i];
+    into->count += from->count;
+    into->sum += from->sum;
+    if (from->max > into->max) into->max = from->max;
+}
+
+static void write_csv_row(FILE *file, const char *metric, const Histogram *histogram) {
+    fprintf(file, "%s,%llu,%lld,%lld,%lld,%.1f\n", metric, (unsigned long long)histogram->count,
+            (long long)histogram_percentile(histogram, 50), (long long)histogram_percentile(histogram, 99),
+            (long long)histogram->max, histogram_mean(histogram));
+}
+
+static void write_json_object(FILE *file, const char *name, const Histogram *histogram, const char *unit, int last) {
+    fprintf(file, "    \"%s\": {\"count\": %llu, \"p50_%s\": %lld, \"p99_%s\": %lld, \"max_%s\": %lld, \"mean_%s\": %.1f}%s\n",
+            name, (unsigned long long)histogram->count,
+            unit, (long long)histogram_percentile(histogram, 50), unit, (long long)histogram_percentile(histogram, 99),
+            unit, (long long)histogram->max, unit, histogram_mean(histogram), last ? "" : ",");
+}
+
+int stats_write(const Stats *stats, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) return 0;
+
+    size_t len = strlen(path);
+    if (len >= 5 && !strcmp(path + len - 5, ".json")) {
+        fprintf(file, "{\n  \"ticks\": %lld,\n  \"tick_overruns\": %lld,\n  \"phases\": {\n", stats->ticks, stats->overruns);
+        for (int i = 0; i < PHASE_COUNT; i++) {
+            write_json_object(file, phase_names[i], &stats->phases[i], "ns", i == PHASE_COUNT - 1);
+        }
+        fprintf(file, "  },\n  \"frames\": {\n");
+        write_json_object(file, "bytes", &stats->frame_bytes, "bytes", 1);
+        fprintf(file, "  }\n}\n");
+    } else {
+        // phases in ns, frame sizes in bytes; counters use the count column only
+        fprintf(file, "metric,count,p50,p99,max,mean\n");
+        for (int i = 0; i < PHASE_COUNT; i++) {
+            char metric[32];
+            snprintf(metric, sizeof(metric), "%s_ns", phase_names[i]);
+            write_csv_row(file, metric, &stats->phases[i]);
+        }
+        write_csv_row(file, "frame_bytes", &stats->frame_bytes);
+        fprintf(file, "ticks,%lld,,,,\n", stats->ticks);
+        fprintf(file, "tick_overruns,%lld,,,,\n", stats->overruns);
+    }
+    return fclose(file) == 0;
+}
@@ -0,0 +1,64 @@
+#ifndef SNAKE_STATS_H
+#define SNAKE_STATS_H
+
+/* Per-phase timers for the hot path. Each phase feeds a log-linear histogram
+   (HdrHistogram style: 16 linear sub-buckets per power of two, so any value
+   is kept within 1/16 of itself) with a fixed bucket array, so recording is
+   a couple of shifts and an increment and never allocates. Instrumented code
+   holds a Stats pointer that is NULL when stats are off: a disabled timer
+   is a single pointer test and never reads the clock. */
+
+#include <stdint.h>
+
+#define HISTOGRAM_SUB_BITS 4
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS (64 * HISTOGRAM_SUB_BUCKETS) // covers every int64_t value
+
+enum phase {
+    PHASE_INPUT = 0,   // process_key_events
+    PHASE_PLAN,        // autopilot_next
+    PHASE_SNAKE,       // compute_snake_position
+    PHASE_ENEMIES,     // compute_enemy_position
+    PHASE_PUBLISH,     // snapshotting a frame for the render thread
+    PHASE_COMPOSE,     // render_glyphs, on the render thread
+    PHASE_WRITE,       // the terminal write, on the render thread
+    PHASE_COUNT
+};
+
+typedef struct {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t count;              // Values recorded
+    int64_t max;                 // Largest value, exact
+    double sum;                  // For the mean
+} Histogram;
+
+typedef struct {
+    int64_t (*clock)(void);      // Host's monotonic clock, ns
+    Histogram phases[PHASE_COUNT]; // Time spent in each enum phase, ns
+    Histogram frame_bytes;       // Bytes written per non-empty frame
+    long long ticks;             // Simulation ticks run
+    long long overruns;          // Loop iterations whose work took longer than a tick
+} Stats;
+
+void stats_init(Stats *stats, int64_t (*clock)(void));
+
+void histogram_record(Histogram *histogram, int64_t value);
+int64_t histogram_percentile(const Histogram *histogram, double percent);
+double histogram_mean(const Histogram *histogram);
+// add every value recorded in `from` to `into`
+void histogram_merge(Histogram *into, const Histogram *from);
+
+// start and stop a phase timer, both do nothing when stats is NULL
+static inline int64_t stats_begin(Stats *stats) {
+    return stats ? stats->clock() : 0;
+}
+
+static inline void stats_end(Stats *stats, enum phase phase, int64_t start) {
+    if (stats) histogram_record(&stats->phases[phase], stats->clock() - start);
+}
+
+// p50/p99/max per phase, frame bytes and overruns; JSON when path ends in .json, CSV otherwise.
+// returns 0 when the file can't be written
+int stats_write(const Stats *stats, const char *path);
+
+#endif
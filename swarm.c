@@ -0,0 +1,349 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "swarm.h"
+
+// indexed by enum direction
+static const int step_dx[] = { 0, 0, -1, 1 };
+static const int step_dy[] = { -1, 1, 0, 0 };
+static const enum direction opposite[] = { DOWN, UP, RIGHT, LEFT };
+
+/* Placement */
+static int distance_to_player(const Swarm *swarm, int cell) {
+    int head = swarm->head[0];
+    return abs(cell % swarm->cols - head % swarm->cols) + abs(cell / swarm->cols - head / swarm->cols);
+}
+
+// a random free cell inside the walls, or -1 after SWARM_PLACE_ATTEMPTS occupied ones
+static int random_free(Swarm *swarm) {
+    for (int attempt = 0; attempt < SWARM_PLACE_ATTEMPTS; attempt++) {
+        int cell = (1 + rng_range(&swarm->rng, swarm->rows - 2)) * swarm->cols + 1 + rng_range(&swarm->rng, swarm->cols - 2);
+        if (swarm->owner[cell] == OWNER_FREE) return cell;
+    }
+    return -1;
+}
+
+// a free cell away from the player's head, -1 when none came up
+static int random_spawn(Swarm *swarm) {
+    int cell = -1;
+    for (int attempt = 0; attempt < ENEMY_SPAWN_ATTEMPTS; attempt++) {
+        cell = random_free(swarm);
+        if (cell < 0 || distance_to_player(swarm, cell) >= SWARM_SPAWN_DISTANCE) break;
+    }
+    return cell;
+}
+
+// with the board full the slot waits for the next tick
+static void place_swarm_food(Swarm *swarm, int slot) {
+    int cell = random_free(swarm);
+    swarm->food[slot] = cell;
+    if (cell >= 0) swarm->owner[cell] = OWNER_FOOD(slot);
+}
+
+static void place_swarm_enemy(Swarm *swarm) {
+    if (swarm->enemy_count >= swarm->enemy_capacity) return;
+    int cell = random_spawn(swarm);
+    if (cell < 0) return;
+    swarm->enemy[swarm->enemy_count++] = cell;
+    swarm->owner[cell] = OWNER_ENEMY;
+}
+
+// a rival comes back as a single segment; 0 when there was no room this tick
+static int spawn_rival(Swarm *swarm, int id) {
+    int cell = random_spawn(swarm);
+    if (cell < 0) return 0;
+    swarm->head[id] = swarm->tail[id] = cell;
+    swarm->length[id] = 1;
+    swarm->heading[id] = (unsigned char)rng_range(&swarm->rng, 4);
+    swarm->target[id] = rng_range(&swarm->rng, swarm->food_count);
+    swarm->owner[cell] = id;
+    swarm->segments++;
+    return 1;
+}
+
+/* Policy */
+// another snake's head is next to the cell: it may step there too
+static int contested(const Swarm *swarm, int id, int cell) {
+    for (int d = 0; d < 4; d++) {
+        int owner = swarm->owner[cell + step_dy[d] * swarm->cols + step_dx[d]];
+        if (owner >= 0 && owner != id && swarm->head[owner] == cell + step_dy[d] * swarm->cols + step_dx[d]) return 1;
+    }
+    return 0;
+}
+
+enum direction swarm_steer(const Swarm *swarm, int id) {
+    int head = swarm->head[id];
+    int goal = swarm->food[swarm->target[id]];
+    int x = head % swarm->cols, y = head / swarm->cols;
+    int gx = goal % swarm->cols, gy = goal / swarm->cols;
+    enum direction heading = (enum direction)swarm->heading[id];
+
+    // the open neighbour closest to the food, keeping the heading on ties; straight on when
+    // nothing is open
+    enum direction best = heading;
+    int best_distance = INT_MAX;
+    for (int i = 0; i < 4; i++) {
+        enum direction d = (enum direction)((heading + i) & 3);
+        if (d == opposite[heading] && swarm->length[id] > 1) continue;
+        int next = head + step_dy[d] * swarm->cols + step_dx[d];
+        int owner = swarm->owner[next];
+        if (owner != OWNER_FREE && !IS_FOOD(owner)) continue;
+        int distance = goal < 0 ? 0 : abs(gx - x - step_dx[d]) + abs(gy - y - step_dy[d]);
+        if (contested(swarm, id, next)) distance += swarm->rows + swarm->cols;
+        if (distance < best_distance) {
+            best = d;
+            best_distance = distance;
+        }
+    }
+    return best;
+}
+
+/* Tick */
+static int claimed(const Swarm *swarm, int cell) {
+    return swarm->claim_tick[cell] == swarm->tick;
+}
+
+// the snake steps into food it won: its tail stays where it is
+static int eating(const Swarm *swarm, int id) {
+    int next = swarm->next[id];
+    return IS_FOOD(swarm->owner[next]) && swarm->claim[next] == id;
+}
+
+// enemies step greedily toward the player's head into free or food cells nobody claimed yet;
+// the cells they step into are theirs whatever a snake wants
+static void plan_swarm_enemies(Swarm *swarm) {
+    int head = swarm->head[0];
+    int hx = head % swarm->cols, hy = head / swarm->cols;
+    for (int i = 0; i < swarm->enemy_count; i++) {
+        int cell = swarm->enemy[i];
+        int x = cell % swarm->cols, y = cell / swarm->cols;
+        int best = cell;
+        int best_distance = abs(hx - x) + abs(hy - y);
+        for (int d = 0; d < 4; d++) {
+            int next = cell + step_dy[d] * swarm->cols + step_dx[d];
+            int owner = swarm->owner[next];
+            if ((owner != OWNER_FREE && !IS_FOOD(owner)) || claimed(swarm, next)) continue;
+            int distance = abs(hx - x - step_dx[d]) + abs(hy - y - step_dy[d]);
+            if (distance < best_distance) {
+                best = next;
+                best_distance = distance;
+            }
+        }
+        swarm->enemy_next[i] = best;
+        if (best != cell) {
+            swarm->claim[best] = OWNER_ENEMY;
+            swarm->claim_tick[best] = swarm->tick;
+        }
+    }
+}
+
+static void move_swarm_enemies(Swarm *swarm) {
+    for (int i = 0; i < swarm->enemy_count; i++) {
+        int next = swarm->enemy_next[i];
+        if (next == swarm->enemy[i]) continue;
+        int owner = swarm->owner[next];
+        if (IS_FOOD(owner)) swarm->food[FOOD_SLOT(owner)] = -1; // enemy 'eats' the food
+        swarm->owner[swarm->enemy[i]] = OWNER_FREE;
+        swarm->owner[next] = OWNER_ENEMY;
+        swarm->enemy[i] = next;
+    }
+}
+
+// every live snake picks its next cell and claims it: enemies keep theirs, the longer snake
+// (the lower id between equals) takes a cell from another
+static void plan_swarm_snakes(Swarm *swarm) {
+    for (int id = 0; id < swarm->snake_count; id++) {
+        if (!swarm->length[id]) continue;
+        enum direction d = id == 0 ? swarm->dir : swarm_steer(swarm, id);
+        int head = swarm->head[id];
+        int x = head % swarm->cols + step_dx[d], y = head / swarm->cols + step_dy[d];
+        // same rules as compute_snake_position: walls kill until the wrap-around is unlocked
+        if (id == 0 && swarm->score >= LEVEL_UPGRADE_SCORE) {
+            x = x == 0 ? swarm->cols - 2 : (x == swarm->cols - 1 ? 1 : x);
+            y = y == 0 ? swarm->rows - 2 : (y == swarm->rows - 1 ? 1 : y);
+        }
+        int next = y * swarm->cols + x;
+        swarm->heading[id] = (unsigned char)d;
+        swarm->next[id] = next;
+
+        if (!claimed(swarm, next)) {
+            swarm->claim[next] = id;
+            swarm->claim_tick[next] = swarm->tick;
+            continue;
+        }
+        // ids come in order, so the earlier claimant wins ties
+        int rival = swarm->claim[next];
+        if (rival >= 0 && swarm->length[id] > swarm->length[rival]) swarm->claim[next] = id;
+    }
+}
+
+// one pass over the snakes: a snake dies when it lost its cell, or the cell holds a wall, an
+// enemy or a body other than a tail about to move (two snakes swapping cells die both). the
+// dying are marked with their respawn delay
+static void resolve_swarm(Swarm *swarm) {
+    for (int id = 0; id < swarm->snake_count; id++) {
+        if (!swarm->length[id]) continue;
+        int next = swarm->next[id];
+        int owner = swarm->owner[next];
+        int dies = swarm->claim[next] != id || owner == OWNER_WALL || owner == OWNER_ENEMY ||
+                   (owner >= 0 && (next != swarm->tail[owner] || eating(swarm, owner) ||
+                                   (owner != id && swarm->next[owner] == swarm->head[id])));
+        if (dies) swarm->respawn[id] = SWARM_RESPAWN_TICKS;
+    }
+}
+
+// a dead snake's cells are freed from the tail up
+static void remove_snake(Swarm *swarm, int id) {
+    int cell = swarm->tail[id];
+    for (int i = 0; i < swarm->length[id]; i++) {
+        swarm->owner[cell] = OWNER_FREE;
+        cell = swarm->link[cell];
+    }
+    swarm->segments -= swarm->length[id];
+    swarm->length[id] = 0;
+    if (id == 0) swarm->game_over = 1;
+    else swarm->deaths++;
+}
+
+static void move_swarm_snakes(Swarm *swarm) {
+    // the dead go and every tail that moves is vacated before any head moves in
+    for (int id = 0; id < swarm->snake_count; id++) {
+        if (!swarm->length[id]) continue;
+        if (swarm->respawn[id]) remove_snake(swarm, id);
+        else if (!IS_FOOD(swarm->owner[swarm->next[id]])) swarm->owner[swarm->tail[id]] = OWNER_FREE;
+    }
+
+    for (int id = 0; id < swarm->snake_count; id++) {
+        if (!swarm->length[id]) continue;
+        int next = swarm->next[id];
+        int owner = swarm->owner[next];
+        swarm->link[swarm->head[id]] = next;
+        swarm->head[id] = next;
+        swarm->owner[next] = id;
+        if (!IS_FOOD(owner)) {
+            swarm->tail[id] = swarm->link[swarm->tail[id]];
+            continue;
+        }
+
+        swarm->food[FOOD_SLOT(owner)] = -1;
+        swarm->length[id]++;
+        swarm->segments++;
+        if (id == 0) {
+            swarm->score++;
+            if (swarm->speed > 0) swarm->speed--;
+        } else {
+            swarm->target[id] = rng_range(&swarm->rng, swarm->food_count);
+        }
+    }
+}
+
+void swarm_tick(Swarm *swarm) {
+    // waiting for the first input
+    if (swarm->dir == NONE) return;
+    swarm->tick++;
+
+    int enemies_move = swarm->enemy_count > 0 && ++swarm->enemy_move_counter >= ENEMY_MOVE_INTERVAL;
+    if (enemies_move) {
+        int64_t start = stats_begin(swarm->stats);
+        plan_swarm_enemies(swarm);
+        stats_end(swarm->stats, PHASE_ENEMIES, start);
+        swarm->enemy_move_counter = 0;
+    }
+
+    int64_t start = stats_begin(swarm->stats);
+    plan_swarm_snakes(swarm);
+    resolve_swarm(swarm);
+    if (enemies_move) move_swarm_enemies(swarm);
+    int score = swarm->score;
+    move_swarm_snakes(swarm);
+
+    // placed once every head has moved, so nothing lands on a cell a tail just left and a head
+    // is about to take: an enemy for the player's point, the eaten food, the rivals whose time is up
+    if (swarm->score > score) place_swarm_enemy(swarm);
+    for (int slot = 0; slot < swarm->food_count; slot++) {
+        if (swarm->food[slot] < 0) place_swarm_food(swarm, slot);
+    }
+    for (int id = 1; id < swarm->snake_count; id++) {
+        if (swarm->length[id] || --swarm->respawn[id] > 0) continue;
+        if (!spawn_rival(swarm, id)) swarm->respawn[id] = 1;
+    }
+    stats_end(swarm->stats, PHASE_SNAKE, start);
+}
+
+/* Swarm API */
+void swarm_init(Swarm *swarm, const GameConfig *config, int rivals) {
+    memset(swarm, 0, sizeof(*swarm));
+    rng_seed(&swarm->rng, config->seed);
+    swarm->rows = config->rows < MIN_GRID_ROWS ? MIN_GRID_ROWS : config->rows;
+    swarm->cols = config->cols < MIN_GRID_COLS ? MIN_GRID_COLS : config->cols;
+    int cells = swarm->rows * swarm->cols;
+    int room = (swarm->rows - 2) * (swarm->cols - 2) / SWARM_CELLS_PER_RIVAL;
+    if (rivals > SWARM_MAX_RIVALS) rivals = SWARM_MAX_RIVALS;
+    if (rivals > room) rivals = room;
+    if (rivals < 0) rivals = 0;
+    swarm->snake_count = rivals + 1;
+    swarm->food_count = 1 + rivals / SWARM_SNAKES_PER_FOOD;
+    swarm->enemy_capacity = config->max_enemies > 0 ? config->max_enemies : 0;
+    int snakes = swarm->snake_count;
+    int enemies = swarm->enemy_capacity > 0 ? swarm->enemy_capacity : 1;
+
+    // everything is sized here, a tick never allocates
+    size_t size = 4 * ARENA_SIZE((size_t)cells * sizeof(int)) +
+                  6 * ARENA_SIZE((size_t)snakes * sizeof(int)) + ARENA_SIZE(snakes) +
+                  ARENA_SIZE((size_t)swarm->food_count * sizeof(int)) +
+                  2 * ARENA_SIZE((size_t)enemies * sizeof(int));
+    arena_init(&swarm->arena, size);
+    Arena *arena = &swarm->arena;
+    swarm->owner = ARENA_NEW(arena, int, cells);
+    swarm->link = ARENA_NEW(arena, int, cells);
+    swarm->claim = ARENA_NEW(arena, int, cells);
+    swarm->claim_tick = ARENA_NEW(arena, uint32_t, cells);
+    swarm->head = ARENA_NEW(arena, int, snakes);
+    swarm->tail = ARENA_NEW(arena, int, snakes);
+    swarm->length = ARENA_NEW(arena, int, snakes);
+    swarm->next = ARENA_NEW(arena, int, snakes);
+    swarm->target = ARENA_NEW(arena, int, snakes);
+    swarm->respawn = ARENA_NEW(arena, int, snakes);
+    swarm->heading = ARENA_NEW(arena, unsigned char, snakes);
+    swarm->food = ARENA_NEW(arena, int, swarm->food_count);
+    swarm->enemy = ARENA_NEW(arena, int, enemies);
+    swarm->enemy_next = ARENA_NEW(arena, int, enemies);
+
+    for (int y = 0; y < swarm->rows; y++) {
+        for (int x = 0; x < swarm->cols; x++) {
+            int wall = x == 0 || y == 0 || x == swarm->cols - 1 || y == swarm->rows - 1;
+            swarm->owner[y * swarm->cols + x] = wall ? OWNER_WALL : OWNER_FREE;
+        }
+    }
+
+    swarm->dir = NONE;
+    swarm->speed = config->speed;
+    int center = swarm->rows / 2 * swarm->cols + swarm->cols / 2;
+    swarm->head[0] = swarm->tail[0] = center;
+    swarm->length[0] = 1;
+    swarm->heading[0] = RIGHT;
+    swarm->owner[center] = 0;
+    swarm->segments = 1;
+    for (int id = 1; id < snakes; id++) {
+        if (!spawn_rival(swarm, id)) swarm->respawn[id] = 1;
+    }
+    for (int slot = 0; slot < swarm->food_count; slot++) place_swarm_food(swarm, slot);
+}
+
+void swarm_free(Swarm *swarm) {
+    arena_free(&swarm->arena);
+    memset(swarm, 0, sizeof(*swarm));
+}
+
+void swarm_render_glyphs(const Swarm *swarm, char *glyphs) {
+    int cells = swarm->rows * swarm->cols;
+    for (int i = 0; i < cells; i++) {
+        int owner = swarm->owner[i];
+        if (owner == 0) glyphs[i] = i == swarm->head[0] ? SNAKE_HEAD_CHAR : SNAKE_BODY_CHAR;
+        else if (owner > 0) glyphs[i] = i == swarm->head[owner] ? RIVAL_HEAD_CHAR : RIVAL_BODY_CHAR;
+        else if (owner == OWNER_FREE) glyphs[i] = EMPTY_CHAR;
+        else if (owner == OWNER_WALL) glyphs[i] = WALL_CHAR;
+        else if (owner == OWNER_ENEMY) glyphs[i] = ENEMY_CHAR;
+        else glyphs[i] = FOOD_CHAR;
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef SNAKE_SWARM_H
+#define SNAKE_SWARM_H
+
+/* Rival snakes: the player shares the board with hundreds of AI snakes. The
+   board is an owner grid, one int per cell naming what is there (a snake, the
+   wall, an enemy or a food slot), and each body is a chain of cells, every
+   cell linking to the next one toward its snake's head. Moving a snake is
+   then a few grid writes whatever its length, and nothing is ever searched
+   for: every collision is one lookup in the grid.
+
+   Every snake moves at once. A tick first plans each snake's next cell and
+   claims it in a claim grid (stamped with the tick, so it is never cleared),
+   then resolves every collision in one pass over the snakes and applies the
+   survivors' moves. Ties are broken the same way every time:
+     - an enemy stepping into a cell wins it, the snake dies;
+     - two heads stepping into the same cell: the longer snake wins, the lower
+       id (the player is 0) when they are as long, the other one dies;
+     - a tail is free to step into unless its snake is eating this tick;
+     - two snakes stepping into each other's heads both die.
+   A tick costs O(snakes) plus the bodies of the snakes that died, so it grows
+   with the segments on the board, never with pairs of snakes.
+
+   Dead rivals come back after SWARM_RESPAWN_TICKS. The rules for the player
+   are those of game.c: walls kill until the wrap-around is unlocked, and one
+   enemy joins per point scored. Nothing moves before the player's first key. */
+
+#include "game.h"
+
+#define SWARM_MAX_RIVALS 4096
+#define SWARM_CELLS_PER_RIVAL 16       // rivals are capped so the board keeps this much room for each
+#define SWARM_SNAKES_PER_FOOD 4        // food slots: one per this many snakes, at least one
+#define SWARM_RESPAWN_TICKS 32         // a dead rival is away this long
+#define SWARM_SPAWN_DISTANCE 8         // rivals and enemies never spawn closer to the head than this
+#define SWARM_PLACE_ATTEMPTS 64        // random cells tried per placement before waiting a tick
+
+// what a cell of the owner grid holds, snake ids are >= 0
+#define OWNER_FREE (-1)
+#define OWNER_WALL (-2)
+#define OWNER_ENEMY (-3)
+#define OWNER_FOOD(slot) (-4 - (slot)) // food slots count down from here
+#define IS_FOOD(owner) ((owner) <= -4)
+#define FOOD_SLOT(owner) (-4 - (owner))
+
+typedef struct {
+    int rows, cols;              // Board size, walls included
+    Arena arena;                 // Every array below, reserved once by swarm_init
+    int *owner;                  // Per cell: snake id or an OWNER_ value
+    int *link;                   // Per body cell: the next cell toward the head
+    int *claim;                  // Per cell: the winner of the cell this tick
+    uint32_t *claim_tick;        // Per cell: tick the claim was made, older claims are void
+    uint32_t tick;
+    int snake_count;             // Rivals plus the player, who is snake 0
+    int *head, *tail;            // Cells (row * cols + col) of each snake
+    int *length;                 // 0 while dead
+    unsigned char *heading;      // enum direction of the last move
+    int *next;                   // Cell each snake steps into this tick
+    int *target;                 // Food slot each rival is after
+    int *respawn;                // Ticks until a dead rival comes back
+    int *food;                   // Cell of each food slot, -1 while waiting for room
+    int food_count;
+    int *enemy, *enemy_next;     // Enemy cells now and after this tick
+    int enemy_count, enemy_capacity;
+    long long segments;          // Body cells of every snake on the board
+    long long deaths;            // Rivals that died
+    int score;                   // Player's score
+    enum direction dir;          // Player's direction
+    int game_over;               // The player died
+    int speed;                   // Tick period in ms, shrinks as the score grows
+    int enemy_move_counter;
+    Rng rng;
+    Stats *stats;                // Phase timers, NULL when disabled
+} Swarm;
+
+// config gives the board, the seed and the enemy cap; rivals is capped at SWARM_MAX_RIVALS
+// and at what the board has room for
+void swarm_init(Swarm *swarm, const GameConfig *config, int rivals);
+void swarm_free(Swarm *swarm);
+
+void swarm_tick(Swarm *swarm);
+
+// the rivals' policy for snake `id`: toward its food slot, away from anything in the way
+enum direction swarm_steer(const Swarm *swarm, int id);
+
+// rows * cols display glyphs, row-major, like game_render_glyphs
+void swarm_render_glyphs(const Swarm *swarm, char *glyphs);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef SNAKE_TERM_H
+#define SNAKE_TERM_H
+
+/* Terminal backend: everything the front end needs from the platform.
+   term_win32.c drives the Windows console, term_posix.c a termios terminal;
+   link exactly one of them. Both decode input into the same key codes, so
+   snake.c handles keys the same way everywhere. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CTRL_KEY(k) ((k) & 0x1F)
+
+// key codes past the byte range, plain keys are their character
+enum EditorKey {
+    ARROW_LEFT = 1000,
+    ARROW_RIGHT,
+    ARROW_UP,
+    ARROW_DOWN,
+    KEY_RESIZE            // the terminal changed size, whatever was on screen is gone
+};
+
+// raw, non-echoing, non-blocking input; the original mode is restored at exit
+void term_enable_raw_mode(void);
+
+// write a whole buffer, one system call unless the terminal takes it in pieces
+void term_write(const char *buf, size_t len);
+
+// decode the input available right now into at most `max` keys, never blocks
+int term_read_keys(int *keys, int max);
+
+// sleep in the kernel for up to `ns`, waking early when input arrives
+void term_wait(int64_t ns);
+
+// visible size of the terminal in character cells, 0 when it can't be told
+int term_size(int *rows, int *cols);
+
+// monotonic nanoseconds, immune to wall-clock changes
+int64_t term_now_ns(void);
+
+#endif
@@ -0,0 +1,173 @@
+#define _POSIX_C_SOURCE 200809L
+#if defined(__linux__)
+#define _GNU_SOURCE // ppoll
+#endif
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "game.h"
+#include "term.h"
+
+#define INPUT_BATCH 64 // bytes read per call
+
+/* Data structures */
+typedef struct {
+    struct termios orig_termios; // Original terminal attributes
+    int raw;                     // Raw mode is on and has to be undone at exit
+    unsigned char pending[8];    // Start of an escape sequence split across reads
+    int pending_len;
+} TerminalConfig;
+
+static TerminalConfig terminal_config;
+static volatile sig_atomic_t resized = 0;
+
+/* Terminal API */
+static void disableRawMode() {
+    if (!terminal_config.raw) return;
+    terminal_config.raw = 0;
+    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &terminal_config.orig_termios) == -1) die("tcsetattr");
+}
+
+static void on_sigwinch(int sig) {
+    (void)sig;
+    resized = 1;
+}
+
+void term_enable_raw_mode(void) {
+    if (tcgetattr(STDIN_FILENO, &terminal_config.orig_termios) == -1) die("tcgetattr");
+    terminal_config.raw = 1;
+    atexit(disableRawMode);
+
+    struct termios raw = terminal_config.orig_termios;
+    // no echo, no line buffering, no signals from ^C/^Z and no ^S/^Q flow control (^Q quits)
+    raw.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+    raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
+    raw.c_cflag |= CS8;
+    // read() returns whatever is there, possibly nothing
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == -1) die("tcsetattr");
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_sigwinch;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGWINCH, &sa, NULL) == -1) die("sigaction");
+}
+
+void term_write(const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(STDOUT_FILENO, buf, len);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        buf += written;
+        len -= (size_t)written;
+    }
+}
+
+// decode one key at `in`, returns the bytes it used, 0 when the sequence is incomplete
+static int decode_key(const unsigned char *in, int len, int *key) {
+    if (in[0] != '\x1b') {
+        *key = in[0];
+        return 1;
+    }
+    if (len < 2) return 0;
+    // ESC [ A (normal cursor keys) or ESC O A (application cursor keys)
+    if (in[1] != '[' && in[1] != 'O') {
+        *key = '\x1b';
+        return 1;
+    }
+    if (len < 3) return 0;
+    switch (in[2]) {
+        case 'A': *key = ARROW_UP; return 3;
+        case 'B': *key = ARROW_DOWN; return 3;
+        case 'C': *key = ARROW_RIGHT; return 3;
+        case 'D': *key = ARROW_LEFT; return 3;
+    }
+    // some other sequence (function keys, ...): skip up to its final byte
+    int i = 2;
+    while (i < len && !(in[i] >= 0x40 && in[i] <= 0x7E)) i++;
+    if (i == len) return 0;
+    *key = '\x1b';
+    return i + 1;
+}
+
+int term_read_keys(int *keys, int max) {
+    unsigned char buf[sizeof(terminal_config.pending) + INPUT_BATCH];
+    int count = 0;
+
+    if (resized && count < max) {
+        resized = 0;
+        keys[count++] = KEY_RESIZE;
+    }
+    while (count < max) {
+        int len = terminal_config.pending_len;
+        // every byte decodes to one key at most: read no more than the free slots can take, the
+        // rest waits in the terminal for the next call instead of being decoded and dropped
+        int batch = max - count - len < INPUT_BATCH ? max - count - len : INPUT_BATCH;
+        if (batch <= 0) break;
+        memcpy(buf, terminal_config.pending, len);
+        ssize_t n = read(STDIN_FILENO, buf + len, (size_t)batch);
+        if (n < 0 && errno != EINTR && errno != EAGAIN) die("read");
+        if (n <= 0) {
+            // nothing more is coming: a lone ESC really was the Escape key
+            if (len > 0 && n == 0) {
+                keys[count++] = '\x1b';
+                terminal_config.pending_len = 0;
+            }
+            break;
+        }
+        len += (int)n;
+
+        int pos = 0;
+        while (pos < len && count < max) {
+            int used = decode_key(buf + pos, len - pos, &keys[count]);
+            if (used == 0) break;
+            pos += used;
+            count++;
+        }
+        // keep an incomplete sequence for the next read; only an unknown sequence longer than
+        // pending gets dropped, every complete key found a slot
+        int rest = len - pos;
+        if (rest > (int)sizeof(terminal_config.pending)) rest = 0;
+        memcpy(terminal_config.pending, buf + pos, rest);
+        terminal_config.pending_len = rest;
+    }
+    return count;
+}
+
+void term_wait(int64_t ns) {
+    if (ns <= 0) return;
+    struct pollfd fd = { STDIN_FILENO, POLLIN, 0 };
+#if defined(__linux__)
+    // ppoll takes the full-resolution timeout
+    struct timespec timeout = { (time_t)(ns / 1000000000LL), (long)(ns % 1000000000LL) };
+    ppoll(&fd, 1, &timeout, NULL);
+#else
+    // round up, waking early would only spin the loop once more
+    poll(&fd, 1, (int)((ns + 999999) / 1000000));
+#endif
+    // EINTR (SIGWINCH) is fine: the loop reads the resize and waits again
+}
+
+int term_size(int *rows, int *cols) {
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || ws.ws_col == 0) return 0;
+    *rows = ws.ws_row;
+    *cols = ws.ws_col;
+    return 1;
+}
+
+int64_t term_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
@@ -0,0 +1,127 @@
+#include <stdlib.h>
+#include <windows.h>
+#include "game.h"
+#include "term.h"
+
+#define INPUT_BATCH 32 // console input records read per call
+
+/* Data structures */
+typedef struct {
+    DWORD orig_mode;    // Original console mode
+    HANDLE hStdin;      // Console input handle
+    HANDLE hStdout;     // Console output handle
+    HANDLE hTimer;      // Waitable timer the game loop sleeps on
+} TerminalConfig;
+
+static TerminalConfig terminal_config;
+
+/* Terminal API */
+static void disableRawMode() {
+    if (!SetConsoleMode(terminal_config.hStdin, terminal_config.orig_mode)) die("SetConsoleMode");
+}
+
+void term_enable_raw_mode(void) {
+    terminal_config.hStdin = GetStdHandle(STD_INPUT_HANDLE);
+    terminal_config.hStdout = GetStdHandle(STD_OUTPUT_HANDLE);
+
+    if (terminal_config.hStdin == INVALID_HANDLE_VALUE || terminal_config.hStdout == INVALID_HANDLE_VALUE)
+        die("GetStdHandle");
+
+    if (!GetConsoleMode(terminal_config.hStdin, &terminal_config.orig_mode)) die("GetConsoleMode");
+
+    atexit(disableRawMode);
+
+    DWORD mode = terminal_config.orig_mode;
+    mode &= ~(ENABLE_ECHO_INPUT | ENABLE_LINE_INPUT | ENABLE_PROCESSED_INPUT);
+    mode |= (ENABLE_WINDOW_INPUT | ENABLE_MOUSE_INPUT);
+    if (!SetConsoleMode(terminal_config.hStdin, mode)) die("SetConsoleMode (input)");
+
+    // enable ANSI escape sequences on the output
+    DWORD outMode = 0;
+    if (!GetConsoleMode(terminal_config.hStdout, &outMode)) die("GetConsoleMode (output)");
+    outMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+    if (!SetConsoleMode(terminal_config.hStdout, outMode)) die("SetConsoleMode (output)");
+
+    // Sleep() rounds up to the 15.6 ms scheduler tick, a high resolution timer does not
+    terminal_config.hTimer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!terminal_config.hTimer) terminal_config.hTimer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+    if (!terminal_config.hTimer) die("CreateWaitableTimerEx");
+}
+
+void term_write(const char *buf, size_t len) {
+    DWORD written;
+    while (len > 0) {
+        if (!WriteConsole(terminal_config.hStdout, buf, (DWORD)len, &written, NULL)) return;
+        buf += written;
+        len -= written;
+    }
+}
+
+// drain everything pending, a batch of records per read
+int term_read_keys(int *keys, int max) {
+    INPUT_RECORD records[INPUT_BATCH];
+    DWORD events;
+    DWORD read;
+    int count = 0;
+
+    while (count < max) {
+        // check if there is input available
+        if (!GetNumberOfConsoleInputEvents(terminal_config.hStdin, &events) || events == 0) break;
+
+        // if there is input, read it (never blocks, the events are already there)
+        DWORD batch = events < INPUT_BATCH ? events : INPUT_BATCH;
+        if (batch > (DWORD)(max - count)) batch = (DWORD)(max - count);
+        if (!ReadConsoleInput(terminal_config.hStdin, records, batch, &read) || read == 0) break;
+
+        for (DWORD i = 0; i < read; i++) {
+            INPUT_RECORD *ir = &records[i];
+
+            if (ir->EventType == WINDOW_BUFFER_SIZE_EVENT) {
+                keys[count++] = KEY_RESIZE;
+                continue;
+            }
+            // mouse, focus and key-up events are consumed here without costing a tick
+            if (ir->EventType != KEY_EVENT || !ir->Event.KeyEvent.bKeyDown) continue;
+
+            WORD vk = ir->Event.KeyEvent.wVirtualKeyCode;
+            CHAR ch = ir->Event.KeyEvent.uChar.AsciiChar;
+            switch (vk) {
+                case VK_LEFT:  keys[count++] = ARROW_LEFT; break;
+                case VK_UP:    keys[count++] = ARROW_UP; break;
+                case VK_RIGHT: keys[count++] = ARROW_RIGHT; break;
+                case VK_DOWN:  keys[count++] = ARROW_DOWN; break;
+                default: keys[count++] = (unsigned char)ch; break;
+            }
+        }
+    }
+    return count;
+}
+
+void term_wait(int64_t ns) {
+    if (ns <= 0) return;
+    LARGE_INTEGER due;
+    due.QuadPart = -(ns / 100); // relative, in 100 ns units
+    if (!SetWaitableTimer(terminal_config.hTimer, &due, 0, NULL, NULL, FALSE)) die("SetWaitableTimer");
+    // the console input handle is signalled while events are pending
+    HANDLE handles[2] = { terminal_config.hTimer, terminal_config.hStdin };
+    WaitForMultipleObjects(2, handles, FALSE, INFINITE);
+}
+
+int term_size(int *rows, int *cols) {
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (!GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) return 0;
+    // the window, not the scrollback buffer
+    *rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+    *cols = info.srWindow.Right - info.srWindow.Left + 1;
+    return 1;
+}
+
+int64_t term_now_ns(void) {
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER counter;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    // split to avoid overflowing the multiplication on long uptimes
+    return (counter.QuadPart / freq.QuadPart) * 1000000000LL +
+           (counter.QuadPart % freq.QuadPart) * 1000000000LL / freq.QuadPart;
+}
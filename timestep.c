@@ -0,0 +1,75 @@
+#include <math.h>
+#include <string.h>
+#include "timestep.h"
+
+void timestep_init(Timestep *ts, int64_t now, int64_t tick_ns, int fps) {
+    memset(ts, 0, sizeof(*ts));
+    ts->tick_ns = tick_ns < TIMESTEP_MIN_TICK_NS ? TIMESTEP_MIN_TICK_NS : tick_ns;
+    ts->frame_ns = fps > 0 ? 1000000000LL / fps : 0;
+    ts->now = now;
+    ts->next_frame = now;
+}
+
+void timestep_set_period(Timestep *ts, int64_t tick_ns) {
+    ts->tick_ns = tick_ns < TIMESTEP_MIN_TICK_NS ? TIMESTEP_MIN_TICK_NS : tick_ns;
+}
+
+int timestep_advance(Timestep *ts, int64_t now) {
+    ts->accumulator += now - ts->now;
+    ts->now = now;
+
+    int64_t due = ts->accumulator / ts->tick_ns;
+    if (due > TIMESTEP_MAX_CATCHUP) {
+        // after a long stall (window dragged, debugger) don't fast-forward the game
+        ts->stats.dropped_ticks += due - TIMESTEP_MAX_CATCHUP;
+        ts->accumulator -= (due - TIMESTEP_MAX_CATCHUP) * ts->tick_ns;
+        due = TIMESTEP_MAX_CATCHUP;
+    }
+    return (int)due;
+}
+
+void timestep_tick_done(Timestep *ts) {
+    TickStats *stats = &ts->stats;
+    // what is left in the accumulator past this tick's period is how late it runs
+    int64_t late = ts->accumulator - ts->tick_ns;
+    ts->accumulator -= ts->tick_ns;
+
+    if (stats->ticks == 0) stats->start = ts->now;
+    stats->last = ts->now;
+    stats->ticks++;
+    stats->late_sum += (double)late;
+    stats->late_sq += (double)late * late;
+    if (late > stats->late_max) stats->late_max = late;
+    ts->undrawn++;
+}
+
+int timestep_frame_due(const Timestep *ts) {
+    return ts->undrawn > 0 && ts->now >= ts->next_frame;
+}
+
+void timestep_frame_done(Timestep *ts) {
+    // every tick but the one on screen went by unseen
+    if (ts->undrawn > 1) ts->stats.skipped_frames += ts->undrawn - 1;
+    ts->stats.frames++;
+    ts->undrawn = 0;
+    // keep the frame grid fixed too, unless drawing fell a whole frame behind
+    ts->next_frame += ts->frame_ns;
+    if (ts->next_frame < ts->now) ts->next_frame = ts->now;
+}
+
+int64_t timestep_wait(const Timestep *ts) {
+    int64_t wait = ts->tick_ns - ts->accumulator;
+    if (ts->undrawn > 0 && ts->next_frame - ts->now < wait) wait = ts->next_frame - ts->now;
+    return wait > 0 ? wait : 0;
+}
+
+double timestep_jitter_mean(const TickStats *stats) {
+    return stats->ticks ? stats->late_sum / stats->ticks : 0;
+}
+
+double timestep_jitter_stddev(const TickStats *stats) {
+    if (stats->ticks == 0) return 0;
+    double mean = stats->late_sum / stats->ticks;
+    double variance = stats->late_sq / stats->ticks - mean * mean;
+    return variance > 0 ? sqrt(variance) : 0;
+}
@@ -0,0 +1,60 @@
+#ifndef SNAKE_TIMESTEP_H
+#define SNAKE_TIMESTEP_H
+
+/* Fixed-timestep scheduler: the host feeds it readings of a monotonic clock
+   and it says how many simulation ticks are due, whether a frame should be
+   drawn and how long the host may sleep. Time owed to the simulation piles up
+   in an accumulator, so a late tick is made up for by the next one instead of
+   pushing every following tick back (no drift), and drawing runs at its own,
+   lower, rate: when output falls behind, frames are skipped, never ticks. */
+
+#include <stdint.h>
+
+#define TIMESTEP_MAX_CATCHUP 5   // ticks run back to back at most, older debt is dropped
+#define TIMESTEP_MIN_TICK_NS 1000000LL // 1 ms, a speed of 0 would otherwise spin
+#define DEFAULT_FPS 60
+
+typedef struct {
+    long long ticks;             // Ticks run
+    long long frames;            // Frames drawn
+    long long skipped_frames;    // Ticks whose state was never drawn
+    long long dropped_ticks;     // Ticks given up to catch up after a stall
+    double late_sum, late_sq;    // Sum and sum of squares of tick lateness in ns
+    int64_t late_max;            // Latest tick, ns after its due time
+    int64_t start;               // Clock reading of the first tick
+    int64_t last;                // Clock reading of the last tick
+} TickStats;
+
+typedef struct {
+    int64_t tick_ns;             // Simulation period
+    int64_t frame_ns;            // Shortest time between two frames
+    int64_t accumulator;         // Time owed to the simulation, ns
+    int64_t now;                 // Last clock reading
+    int64_t next_frame;          // Earliest time the next frame may be drawn
+    int undrawn;                 // Ticks run since the last frame
+    TickStats stats;
+} Timestep;
+
+void timestep_init(Timestep *ts, int64_t now, int64_t tick_ns, int fps);
+
+// the period may change between ticks (the game speeds up as the score grows)
+void timestep_set_period(Timestep *ts, int64_t tick_ns);
+
+// advance the clock, returns how many ticks to run now
+int timestep_advance(Timestep *ts, int64_t now);
+
+// call once per tick actually run
+void timestep_tick_done(Timestep *ts);
+
+// a tick changed the state and the frame rate allows drawing it
+int timestep_frame_due(const Timestep *ts);
+void timestep_frame_done(Timestep *ts);
+
+// ns until the next tick or pending frame, 0 when one is due already
+int64_t timestep_wait(const Timestep *ts);
+
+// mean and standard deviation of tick lateness in ns
+double timestep_jitter_mean(const TickStats *stats);
+double timestep_jitter_stddev(const TickStats *stats);
+
+#endif
@@ -0,0 +1,460 @@
+#include <stdlib.h>
+#include <string.h>
+#include "world.h"
+
+#define WORLD_BUCKETS 256      // initial hash table size, doubled as chunks come in
+#define WORLD_BODY_SLOTS 256   // initial ring size of the body
+
+/* Chunks */
+static unsigned chunk_hash(int cx, int cy) {
+    uint32_t h = (uint32_t)cx * 0x9E3779B1u ^ (uint32_t)cy * 0x85EBCA77u;
+    return h ^ (h >> 15);
+}
+
+static Chunk *chunk_find(const World *world, int cx, int cy) {
+    Chunk *chunk = world->buckets[chunk_hash(cx, cy) & world->bucket_mask];
+    while (chunk && (chunk->cx != cx || chunk->cy != cy)) chunk = chunk->next;
+    return chunk;
+}
+
+// twice the buckets, every chunk rehashed: only while the snake keeps growing
+static void grow_buckets(World *world) {
+    int count = (world->bucket_mask + 1) * 2;
+    Chunk **buckets = game_alloc((size_t)count * sizeof(Chunk *));
+    memset(buckets, 0, (size_t)count * sizeof(Chunk *));
+    for (int i = 0; i <= world->bucket_mask; i++) {
+        Chunk *chunk = world->buckets[i];
+        while (chunk) {
+            Chunk *next = chunk->next;
+            unsigned bucket = chunk_hash(chunk->cx, chunk->cy) & (count - 1);
+            chunk->next = buckets[bucket];
+            buckets[bucket] = chunk;
+            chunk = next;
+        }
+    }
+    game_release(world->buckets);
+    world->buckets = buckets;
+    world->bucket_mask = count - 1;
+}
+
+// the chunk holding (cx, cy), allocated empty when nothing was there yet
+static Chunk *chunk_get(World *world, int cx, int cy) {
+    Chunk *chunk = chunk_find(world, cx, cy);
+    if (chunk) return chunk;
+
+    if (!world->free_chunks) {
+        ChunkSlab *slab = game_alloc(sizeof(ChunkSlab));
+        slab->next = world->slabs;
+        world->slabs = slab;
+        world->slab_count++;
+        for (int i = CHUNK_SLAB - 1; i >= 0; i--) {
+            slab->chunks[i].next = world->free_chunks;
+            world->free_chunks = &slab->chunks[i];
+        }
+    }
+    chunk = world->free_chunks;
+    world->free_chunks = chunk->next;
+    memset(chunk->layers, 0, sizeof(chunk->layers));
+    chunk->cx = cx;
+    chunk->cy = cy;
+    chunk->population = 0;
+    chunk->enemies = -1;
+
+    if (world->chunks >= 2 * (world->bucket_mask + 1)) grow_buckets(world);
+    unsigned bucket = chunk_hash(cx, cy) & world->bucket_mask;
+    chunk->next = world->buckets[bucket];
+    world->buckets[bucket] = chunk;
+    world->chunks++;
+    return chunk;
+}
+
+// an empty chunk goes back to the free list, the board there reads as empty again
+static void chunk_release_if_empty(World *world, Chunk *chunk) {
+    if (chunk->population > 0 || chunk->enemies >= 0) return;
+    Chunk **link = &world->buckets[chunk_hash(chunk->cx, chunk->cy) & world->bucket_mask];
+    while (*link != chunk) link = &(*link)->next;
+    *link = chunk->next;
+    chunk->next = world->free_chunks;
+    world->free_chunks = chunk;
+    world->chunks--;
+}
+
+/* Cells */
+static int is_wall(const World *world, int x, int y) {
+    return x == 0 || y == 0 || x == world->cols - 1 || y == world->rows - 1;
+}
+
+static int world_test(const World *world, enum world_layer layer, int x, int y) {
+    const Chunk *chunk = chunk_find(world, x >> CHUNK_BITS, y >> CHUNK_BITS);
+    return chunk && (int)((chunk->layers[layer][y & (CHUNK_SIZE - 1)] >> (x & (CHUNK_SIZE - 1))) & 1);
+}
+
+// food, body and head bits; enemies go through enemy_link and enemy_unlink
+static void world_set(World *world, enum world_layer layer, int x, int y) {
+    Chunk *chunk = chunk_get(world, x >> CHUNK_BITS, y >> CHUNK_BITS);
+    uint64_t *word = &chunk->layers[layer][y & (CHUNK_SIZE - 1)];
+    uint64_t bit = 1ULL << (x & (CHUNK_SIZE - 1));
+    if (*word & bit) return;
+    *word |= bit;
+    chunk->population++;
+}
+
+static void world_clear(World *world, enum world_layer layer, int x, int y) {
+    Chunk *chunk = chunk_find(world, x >> CHUNK_BITS, y >> CHUNK_BITS);
+    if (!chunk) return;
+    uint64_t *word = &chunk->layers[layer][y & (CHUNK_SIZE - 1)];
+    uint64_t bit = 1ULL << (x & (CHUNK_SIZE - 1));
+    if (!(*word & bit)) return;
+    *word &= ~bit;
+    chunk->population--;
+    chunk_release_if_empty(world, chunk);
+}
+
+int world_blocked(const World *world, int x, int y) {
+    if (is_wall(world, x, y)) return 1;
+    const Chunk *chunk = chunk_find(world, x >> CHUNK_BITS, y >> CHUNK_BITS);
+    if (!chunk) return 0;
+    int row = y & (CHUNK_SIZE - 1);
+    uint64_t bits = chunk->layers[WORLD_BODY][row] | chunk->layers[WORLD_ENEMY][row];
+    return (int)((bits >> (x & (CHUNK_SIZE - 1))) & 1);
+}
+
+// the camera's top left cell: the head in the middle, the view kept inside the world
+static void camera_origin(const World *world, int *top, int *left) {
+    const SnakeSegment *head = &world->snake.segments[world->snake.head];
+    int y = head->y - world->view_rows / 2;
+    int x = head->x - world->view_cols / 2;
+    if (y > world->rows - world->view_rows) y = world->rows - world->view_rows;
+    if (x > world->cols - world->view_cols) x = world->cols - world->view_cols;
+    *top = y < 0 ? 0 : y;
+    *left = x < 0 ? 0 : x;
+}
+
+// chunk (cx, cy) is close enough to the head to be simulated
+static int is_active(const World *world, int cx, int cy) {
+    const SnakeSegment *head = &world->snake.segments[world->snake.head];
+    return abs(cx - (head->x >> CHUNK_BITS)) <= world->active_radius &&
+           abs(cy - (head->y >> CHUNK_BITS)) <= world->active_radius;
+}
+
+/* Enemies */
+// cells may hold more than one enemy: the bit is set while any enemy of the chunk is there
+static void enemy_link(World *world, int i) {
+    int x = world->enemy_x[i], y = world->enemy_y[i];
+    Chunk *chunk = chunk_get(world, x >> CHUNK_BITS, y >> CHUNK_BITS);
+    world->enemy_next[i] = chunk->enemies;
+    chunk->enemies = i;
+    chunk->layers[WORLD_ENEMY][y & (CHUNK_SIZE - 1)] |= 1ULL << (x & (CHUNK_SIZE - 1));
+}
+
+static void enemy_unlink(World *world, int i) {
+    int x = world->enemy_x[i], y = world->enemy_y[i];
+    Chunk *chunk = chunk_find(world, x >> CHUNK_BITS, y >> CHUNK_BITS);
+    int *link = &chunk->enemies;
+    while (*link != i) link = &world->enemy_next[*link];
+    *link = world->enemy_next[i];
+
+    int shared = 0;
+    for (int j = chunk->enemies; j >= 0; j = world->enemy_next[j]) {
+        if (world->enemy_x[j] == x && world->enemy_y[j] == y) shared = 1;
+    }
+    if (!shared) chunk->layers[WORLD_ENEMY][y & (CHUNK_SIZE - 1)] &= ~(1ULL << (x & (CHUNK_SIZE - 1)));
+    chunk_release_if_empty(world, chunk);
+}
+
+/* Placement */
+static int is_free(const World *world, int x, int y) {
+    if (is_wall(world, x, y)) return 0;
+    const Chunk *chunk = chunk_find(world, x >> CHUNK_BITS, y >> CHUNK_BITS);
+    if (!chunk) return 1;
+    int row = y & (CHUNK_SIZE - 1);
+    uint64_t bits = 0;
+    for (int layer = 0; layer < WORLD_LAYERS; layer++) bits |= chunk->layers[layer][row];
+    return !((bits >> (x & (CHUNK_SIZE - 1))) & 1);
+}
+
+// a random free cell of the rectangle, or 0 after WORLD_PLACE_ATTEMPTS occupied ones
+static int random_free(World *world, int top, int left, int rows, int cols, int *x, int *y) {
+    for (int attempt = 0; attempt < WORLD_PLACE_ATTEMPTS; attempt++) {
+        *y = top + rng_range(&world->rng, rows);
+        *x = left + rng_range(&world->rng, cols);
+        if (is_free(world, *x, *y)) return 1;
+    }
+    return 0;
+}
+
+// food goes where the player can see it; with the view full it waits for the next tick
+static void place_world_food(World *world) {
+    int top, left, x, y;
+    camera_origin(world, &top, &left);
+    if (!random_free(world, top, left, world->view_rows, world->view_cols, &x, &y)) {
+        world->food_x = -1;
+        world->food_y = -1;
+        return;
+    }
+    world->food_x = x;
+    world->food_y = y;
+    world_set(world, WORLD_FOOD, x, y);
+}
+
+// a new enemy somewhere in the active chunks, away from the head. with the pool full
+// an enemy frozen far away is brought back instead
+static void place_world_enemy(World *world) {
+    int slot = -1;
+    if (world->enemy_count < world->enemy_capacity) {
+        slot = world->enemy_count;
+    } else {
+        for (int i = 0; i < world->enemy_count && slot < 0; i++) {
+            if (!is_active(world, world->enemy_x[i] >> CHUNK_BITS, world->enemy_y[i] >> CHUNK_BITS)) slot = i;
+        }
+    }
+    if (slot < 0) return;
+
+    const SnakeSegment *head = &world->snake.segments[world->snake.head];
+    int reach = world->active_radius * CHUNK_SIZE;
+    int top = head->y - reach < 0 ? 0 : head->y - reach;
+    int left = head->x - reach < 0 ? 0 : head->x - reach;
+    int bottom = head->y + reach >= world->rows ? world->rows - 1 : head->y + reach;
+    int right = head->x + reach >= world->cols ? world->cols - 1 : head->x + reach;
+    int x, y;
+    for (int attempt = 0; attempt < ENEMY_SPAWN_ATTEMPTS; attempt++) {
+        if (!random_free(world, top, left, bottom - top + 1, right - left + 1, &x, &y)) return;
+        if (abs(x - head->x) + abs(y - head->y) >= WORLD_SPAWN_DISTANCE) break;
+    }
+
+    if (slot < world->enemy_count) enemy_unlink(world, slot);
+    else world->enemy_count++;
+    world->enemy_x[slot] = x;
+    world->enemy_y[slot] = y;
+    enemy_link(world, slot);
+}
+
+// move the enemies of the active chunks one step closer to the food, the rest stay frozen
+static void move_world_enemies(World *world) {
+    static const int step_dx[] = { 0, 0, -1, 1 };
+    static const int step_dy[] = { -1, 1, 0, 0 };
+    const SnakeSegment *head = &world->snake.segments[world->snake.head];
+    int hcx = head->x >> CHUNK_BITS, hcy = head->y >> CHUNK_BITS;
+
+    // gathered first: an enemy crossing into a chunk not visited yet must not move twice
+    int count = 0;
+    for (int cy = hcy - world->active_radius; cy <= hcy + world->active_radius; cy++) {
+        for (int cx = hcx - world->active_radius; cx <= hcx + world->active_radius; cx++) {
+            const Chunk *chunk = chunk_find(world, cx, cy);
+            if (!chunk) continue;
+            for (int i = chunk->enemies; i >= 0; i = world->enemy_next[i]) world->movers[count++] = i;
+        }
+    }
+
+    for (int m = 0; m < count; m++) {
+        int i = world->movers[m];
+        int x = world->enemy_x[i], y = world->enemy_y[i];
+        int target_x = world->food_x >= 0 ? world->food_x : head->x;
+        int target_y = world->food_x >= 0 ? world->food_y : head->y;
+
+        // greedy: the neighbour closest to the target, the body and the walls block
+        int best = -1;
+        int best_distance = abs(target_x - x) + abs(target_y - y);
+        for (int d = 0; d < 4; d++) {
+            int nx = x + step_dx[d], ny = y + step_dy[d];
+            if (is_wall(world, nx, ny) || world_test(world, WORLD_BODY, nx, ny)) continue;
+            int distance = abs(target_x - nx) + abs(target_y - ny);
+            if (distance < best_distance) {
+                best = d;
+                best_distance = distance;
+            }
+        }
+        if (best < 0) continue;
+
+        enemy_unlink(world, i);
+        x += step_dx[best];
+        y += step_dy[best];
+        world->enemy_x[i] = x;
+        world->enemy_y[i] = y;
+        enemy_link(world, i);
+
+        if (x == world->food_x && y == world->food_y) {
+            world_clear(world, WORLD_FOOD, x, y);
+            place_world_food(world); // enemy 'eats' the food, reposition it
+        }
+        if (x == head->x && y == head->y) world->game_over = 1;
+    }
+}
+
+/* Snake */
+// twice the slots, the body copied head first: the ring only grows with the snake
+static void grow_body(SnakeBody *body) {
+    int capacity = body->capacity * 2;
+    SnakeSegment *segments = game_alloc((size_t)capacity * sizeof(SnakeSegment));
+    for (int i = 0; i < body->length; i++) {
+        segments[i] = body->segments[(body->head + i) % body->capacity];
+    }
+    game_release(body->segments);
+    body->segments = segments;
+    body->capacity = capacity;
+    body->head = 0;
+}
+
+static int wrap_world(int v, int size) {
+    return v == 0 ? size - 2 : (v == size - 1 ? 1 : v);
+}
+
+static void move_world_snake(World *world) {
+    if (world->dir == NONE) return;
+    SnakeSegment *head = snake_head(&world->snake);
+
+    int new_x = head->x;
+    int new_y = head->y;
+    switch (world->dir) {
+        case UP:    new_y--; break;
+        case DOWN:  new_y++; break;
+        case LEFT:  new_x--; break;
+        case RIGHT: new_x++; break;
+        default: break;
+    }
+
+    // same rules as compute_snake_position: walls kill until the wrap-around is unlocked
+    if (world->score >= LEVEL_UPGRADE_SCORE) {
+        new_x = wrap_world(new_x, world->cols);
+        new_y = wrap_world(new_y, world->rows);
+    }
+    if (world_blocked(world, new_x, new_y)) {
+        world->game_over = 1;
+        return;
+    }
+
+    if (world->snake.length == world->snake.capacity) {
+        grow_body(&world->snake);
+        head = snake_head(&world->snake);
+    }
+    world_clear(world, WORLD_HEAD, head->x, head->y);
+    world_set(world, WORLD_BODY, head->x, head->y);
+    snake_push_head(&world->snake, new_x, new_y);
+    world_set(world, WORLD_HEAD, new_x, new_y);
+
+    if (new_x == world->food_x && new_y == world->food_y) {
+        world->score++;
+        world_clear(world, WORLD_FOOD, new_x, new_y);
+        place_world_food(world);
+        place_world_enemy(world);
+        if (world->speed > 0) world->speed--;
+    } else {
+        SnakeSegment *tail = snake_tail(&world->snake);
+        world_clear(world, WORLD_BODY, tail->x, tail->y);
+        snake_pop_tail(&world->snake);
+    }
+}
+
+/* World API */
+void world_init(World *world, const GameConfig *config, int view_rows, int view_cols) {
+    memset(world, 0, sizeof(*world));
+    rng_seed(&world->rng, config->seed);
+    world->rows = config->rows < MIN_GRID_ROWS ? MIN_GRID_ROWS : config->rows;
+    world->cols = config->cols < MIN_GRID_COLS ? MIN_GRID_COLS : config->cols;
+
+    world->buckets = game_alloc(WORLD_BUCKETS * sizeof(Chunk *));
+    memset(world->buckets, 0, WORLD_BUCKETS * sizeof(Chunk *));
+    world->bucket_mask = WORLD_BUCKETS - 1;
+
+    world->snake.segments = game_alloc(WORLD_BODY_SLOTS * sizeof(SnakeSegment));
+    world->snake.capacity = WORLD_BODY_SLOTS;
+
+    int slots = config->max_enemies > 0 ? config->max_enemies : 1;
+    world->enemy_x = game_alloc((size_t)slots * sizeof(int));
+    world->enemy_y = game_alloc((size_t)slots * sizeof(int));
+    world->enemy_next = game_alloc((size_t)slots * sizeof(int));
+    world->movers = game_alloc((size_t)slots * sizeof(int));
+    world->enemy_capacity = config->max_enemies > 0 ? config->max_enemies : 0;
+
+    world->food_x = -1;
+    world->food_y = -1;
+    world->dir = NONE;
+    world->speed = config->speed;
+
+    snake_push_head(&world->snake, world->cols / 2, world->rows / 2);
+    world_set(world, WORLD_HEAD, world->cols / 2, world->rows / 2);
+
+    world->view_rows = view_rows < world->rows ? view_rows : world->rows;
+    world->view_cols = view_cols < world->cols ? view_cols : world->cols;
+    // the whole view is simulated, plus a chunk of margin on each side
+    int half = (world->view_rows > world->view_cols ? world->view_rows : world->view_cols) / 2;
+    world->active_radius = (half + CHUNK_SIZE - 1) / CHUNK_SIZE + 1;
+    place_world_food(world);
+}
+
+void world_free(World *world) {
+    while (world->slabs) {
+        ChunkSlab *next = world->slabs->next;
+        game_release(world->slabs);
+        world->slabs = next;
+    }
+    game_release(world->buckets);
+    game_release(world->snake.segments);
+    game_release(world->enemy_x);
+    game_release(world->enemy_y);
+    game_release(world->enemy_next);
+    game_release(world->movers);
+    memset(world, 0, sizeof(*world));
+}
+
+void world_tick(World *world) {
+    int64_t start = stats_begin(world->stats);
+    move_world_snake(world);
+    stats_end(world->stats, PHASE_SNAKE, start);
+    if (world->game_over) return;
+
+    if (world->enemy_count > 0 && ++world->enemy_move_counter >= ENEMY_MOVE_INTERVAL) {
+        start = stats_begin(world->stats);
+        move_world_enemies(world);
+        stats_end(world->stats, PHASE_ENEMIES, start);
+        world->enemy_move_counter = 0;
+    }
+    // the view was full when the food was last eaten
+    if (world->food_x < 0) place_world_food(world);
+}
+
+// one chunk row span at a time: a missing chunk is a memset, a present one a few bit scans
+void world_render_glyphs(const World *world, char *glyphs) {
+    static const char glyph[WORLD_LAYERS] = { FOOD_CHAR, SNAKE_BODY_CHAR, SNAKE_HEAD_CHAR, ENEMY_CHAR };
+    int top, left;
+    camera_origin(world, &top, &left);
+
+    for (int r = 0; r < world->view_rows; r++) {
+        int y = top + r;
+        char *row = glyphs + (size_t)r * world->view_cols;
+        if (y == 0 || y == world->rows - 1) {
+            memset(row, WALL_CHAR, world->view_cols);
+            continue;
+        }
+        int c = 0;
+        while (c < world->view_cols) {
+            int x = left + c;
+            int offset = x & (CHUNK_SIZE - 1);
+            int span = CHUNK_SIZE - offset;
+            if (span > world->view_cols - c) span = world->view_cols - c;
+            memset(row + c, EMPTY_CHAR, span);
+
+            const Chunk *chunk = chunk_find(world, x >> CHUNK_BITS, y >> CHUNK_BITS);
+            if (chunk) {
+                uint64_t mask = span == 64 ? ~0ULL : (1ULL << span) - 1;
+                for (int layer = 0; layer < WORLD_LAYERS; layer++) {
+                    uint64_t bits = (chunk->layers[layer][y & (CHUNK_SIZE - 1)] >> offset) & mask;
+                    while (bits) {
+                        row[c + ctz64(bits)] = glyph[layer];
+                        bits &= bits - 1;
+                    }
+                }
+            }
+            c += span;
+        }
+        if (left == 0) row[0] = WALL_CHAR;
+        if (left + world->view_cols == world->cols) row[world->view_cols - 1] = WALL_CHAR;
+    }
+}
+
+size_t world_memory(const World *world) {
+    return (size_t)world->slab_count * sizeof(ChunkSlab) +
+           (size_t)(world->bucket_mask + 1) * sizeof(Chunk *) +
+           (size_t)world->snake.capacity * sizeof(SnakeSegment) +
+           4 * (size_t)(world->enemy_capacity > 0 ? world->enemy_capacity : 1) * sizeof(int);
+}
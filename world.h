@@ -0,0 +1,92 @@
+#ifndef SNAKE_WORLD_H
+#define SNAKE_WORLD_H
+
+/* Huge-world mode: a board far bigger than the terminal (10,000 x 10,000 and
+   up), seen through a camera that follows the head. The world is stored as
+   64 x 64-cell chunks, one 64-bit word per chunk row and layer, found through
+   a hash table and allocated the first time something is put in them. A
+   chunk that empties out goes back to a free list, so memory follows what is
+   on the board (the snake, the food and the enemies), never the world's size.
+
+   Only the chunks around the head are simulated: food appears in the
+   camera's view, enemies spawn near the player, and enemies in chunks
+   further away are frozen until the player comes back. A tick costs the same
+   on any world size.
+
+   The rules are those of game.c, except that enemies step greedily toward
+   the food (the flow field would span the whole world) and at most
+   max_enemies exist at once, frozen ones being moved back near the player
+   when a new one is due. */
+
+#include "game.h"
+
+#define CHUNK_BITS 6
+#define CHUNK_SIZE (1 << CHUNK_BITS)   // cells per chunk side, one uint64_t per row
+#define CHUNK_SLAB 64                  // chunks allocated at a time
+#define WORLD_SPAWN_DISTANCE 8         // enemies never spawn closer to the head than this
+#define WORLD_PLACE_ATTEMPTS 64        // random cells tried for food or an enemy per tick
+
+// a world layer per kind of entity, painted in this order
+enum world_layer {
+    WORLD_FOOD = 0,
+    WORLD_BODY,
+    WORLD_HEAD,
+    WORLD_ENEMY,
+    WORLD_LAYERS
+};
+
+typedef struct Chunk {
+    int cx, cy;                  // Chunk coordinates, cells (cx << CHUNK_BITS, cy << CHUNK_BITS) on
+    struct Chunk *next;          // Hash bucket chain, or the free list
+    int population;              // Food, body and head bits set
+    int enemies;                 // First enemy in the chunk, -1 for none
+    uint64_t layers[WORLD_LAYERS][CHUNK_SIZE];
+} Chunk;
+
+typedef struct ChunkSlab {
+    struct ChunkSlab *next;
+    Chunk chunks[CHUNK_SLAB];
+} ChunkSlab;
+
+typedef struct {
+    int rows, cols;              // World size, walls included
+    int view_rows, view_cols;    // Camera size
+    int active_radius;           // Chunks around the head's that are simulated
+    Chunk **buckets;             // Hash table of allocated chunks
+    int bucket_mask;             // Buckets - 1, a power of two
+    int chunks;                  // Chunks in use
+    Chunk *free_chunks;          // Emptied chunks, reused before a new slab
+    ChunkSlab *slabs;            // Every chunk ever allocated
+    int slab_count;
+    SnakeBody snake;             // Grows by doubling, never shrinks
+    int *enemy_x, *enemy_y;      // Enemy pool
+    int *enemy_next;             // Next enemy in the same chunk, -1 at the end
+    int *movers;                 // Scratch: enemies in the active chunks
+    int enemy_count, enemy_capacity;
+    int food_x, food_y;          // -1 when there is none yet
+    int score;
+    enum direction dir;
+    int game_over;
+    int speed;                   // Tick period in ms, shrinks as the score grows
+    int enemy_move_counter;
+    Rng rng;
+    Stats *stats;                // Phase timers, NULL when disabled
+} World;
+
+// config gives the world's size; the camera is view_rows x view_cols, which also sets
+// how far from the head the world is simulated
+void world_init(World *world, const GameConfig *config, int view_rows, int view_cols);
+void world_free(World *world);
+
+void world_tick(World *world);
+
+// the camera's rows x cols window, centred on the head and clamped to the world, as glyphs
+void world_render_glyphs(const World *world, char *glyphs);
+
+// occupancy of a cell, walls included: what the snake dies running into
+int world_blocked(const World *world, int x, int y);
+
+// bytes held by chunks, the hash table, the body and the enemy pool
+size_t world_memory(const World *world);
+
+#endif